@@ -38,6 +38,7 @@ void routing_task(void *pvParameters) {
     while (true) {
         vTaskDelay(pdMS_TO_TICKS(1000));
         rt_on_tick(rt, 1000);
+        sync_on_tick(&_sync, 1000);
     }
 }
 
@@ -8,8 +8,6 @@
 #include "task_config.h"
 #include "callbacks.h"
 
-#define MAX_MESSAGE_SIZE 512
-#define SIBLING_QUEUE_LENGTH 10
 #define PEER_QUEUE_LENGTH 5
 #define PEER_DELAY_SECONDS 2
 
@@ -21,11 +19,6 @@ static void do_nothing_peer(void *ctx, uint32_t net, uint32_t mask) {
 static void do_nothing_message(void *ctx, const uint8_t *data, uint16_t len) {
 }
 
-typedef struct message {
-    uint8_t data[MAX_MESSAGE_SIZE];
-    uint16_t length;
-} message_t;
-
 typedef enum {
     PEER_EVENT_CONNECTED,
     PEER_EVENT_LOST
@@ -42,6 +35,14 @@ static QueueHandle_t peer_event_queue = NULL;
 static QueueHandle_t peer_message_queue = NULL;
 static QueueHandle_t sibling_message_queue = NULL;
 
+// Free buffers of each pool, by pointer. A pool bounds the messages in
+// flight, so each message queue is as long as its pool and never fills up.
+static node_message_t peer_pool[NODE_PEER_POOL_SIZE];
+static node_message_t sibling_pool[NODE_SIBLING_POOL_SIZE];
+static QueueHandle_t free_message_queues[NODE_MESSAGE_POOLS] = { NULL };
+static portMUX_TYPE message_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t sibling_drops = 0;
+
 static wireless_t wireless = {
     .callbacks = {
         .on_peer_connected = do_nothing_peer,
@@ -75,35 +76,51 @@ static void peer_event_task(void *arg) {
 }
 
 static void peer_message_task(void *arg) {
-    message_t m;
+    node_message_t *m;
     while (1) {
         if (xQueueReceive(peer_message_queue, &m, portMAX_DELAY)) {
-            ESP_LOGD(TAG, "Peer message received (%u bytes)", m.length);
-            wl->callbacks.on_peer_message(wl->context, m.data, m.length);
+            ESP_LOGD(TAG, "Peer message received (%u bytes)", m->length);
+            wl->callbacks.on_peer_message(wl->context, m->data, m->length);
+            node_message_unref(m);
         }
     }
 }
 
 static void sibling_message_task(void *arg) {
-    message_t m;
+    node_message_t *m;
     while (1) {
         if (xQueueReceive(sibling_message_queue, &m, portMAX_DELAY)) {
-            ESP_LOGD(TAG, "Sibling message received (%u bytes)", m.length);
-            sb->callback(sb->context, m.data, m.length);
+            ESP_LOGD(TAG, "Sibling message received (%u bytes)", m->length);
+            sb->callback(sb->context, m->data, m->length);
+            node_message_unref(m);
         }
     }
 }
 
 esp_err_t node_init_event_queues(void) {
     peer_event_queue = xQueueCreate(PEER_QUEUE_LENGTH, sizeof(peer_event_t));
-    peer_message_queue = xQueueCreate(PEER_QUEUE_LENGTH, sizeof(message_t));
-    sibling_message_queue = xQueueCreate(SIBLING_QUEUE_LENGTH, sizeof(message_t));
+    peer_message_queue = xQueueCreate(NODE_PEER_POOL_SIZE, sizeof(node_message_t *));
+    sibling_message_queue = xQueueCreate(NODE_SIBLING_POOL_SIZE, sizeof(node_message_t *));
+    free_message_queues[NODE_MESSAGE_POOL_PEER] = xQueueCreate(NODE_PEER_POOL_SIZE, sizeof(node_message_t *));
+    free_message_queues[NODE_MESSAGE_POOL_SIBLING] = xQueueCreate(NODE_SIBLING_POOL_SIZE, sizeof(node_message_t *));
 
-    if (!peer_event_queue || !peer_message_queue || !sibling_message_queue) {
+    if (!peer_event_queue || !peer_message_queue || !sibling_message_queue
+        || !free_message_queues[NODE_MESSAGE_POOL_PEER] || !free_message_queues[NODE_MESSAGE_POOL_SIBLING]) {
         ESP_LOGE(TAG, "Failed to create one or more queues");
         return ESP_FAIL;
     }
 
+    for (int i = 0; i < NODE_PEER_POOL_SIZE; i++) {
+        node_message_t *m = &peer_pool[i];
+        m->pool = NODE_MESSAGE_POOL_PEER;
+        xQueueSend(free_message_queues[NODE_MESSAGE_POOL_PEER], &m, 0);
+    }
+    for (int i = 0; i < NODE_SIBLING_POOL_SIZE; i++) {
+        node_message_t *m = &sibling_pool[i];
+        m->pool = NODE_MESSAGE_POOL_SIBLING;
+        xQueueSend(free_message_queues[NODE_MESSAGE_POOL_SIBLING], &m, 0);
+    }
+
     ESP_LOGI(TAG, "Event queues created successfully");
     return ESP_OK;
 }
@@ -153,20 +170,64 @@ void node_on_peer_lost(uint32_t net, uint32_t mask, peer_type_t peer_type) {
     xQueueSend(peer_event_queue, &event, portMAX_DELAY);
 }
 
-void node_on_peer_message(void *msg, uint16_t len) {
-    message_t m;
-    memcpy(m.data, msg, len);
-    m.length = len;
+node_message_t *node_message_alloc(node_message_pool_t pool, TickType_t ticks) {
+    node_message_t *m;
+    if (xQueueReceive(free_message_queues[pool], &m, ticks) != pdTRUE) {
+        return NULL;
+    }
+    m->length = 0;
+    m->refs = 1;
+    return m;
+}
+
+void node_message_ref(node_message_t *m) {
+    portENTER_CRITICAL(&message_lock);
+    m->refs++;
+    portEXIT_CRITICAL(&message_lock);
+}
+
+void node_message_unref(node_message_t *m) {
+    portENTER_CRITICAL(&message_lock);
+    uint8_t refs = --m->refs;
+    portEXIT_CRITICAL(&message_lock);
 
+    if (refs == 0) {
+        xQueueSend(free_message_queues[m->pool], &m, 0);
+    }
+}
+
+void node_on_peer_message(node_message_t *m) {
     xQueueSend(peer_message_queue, &m, portMAX_DELAY);
 }
 
-void node_on_sibling_message(void *msg, uint16_t len) {
-    message_t m;
-    memcpy(m.data, msg, len);
-    m.length = len;
+esp_err_t node_on_sibling_message(const void *msg, uint16_t len) {
+    if (len > NODE_MESSAGE_MAX_SIZE) {
+        ESP_LOGW(TAG, "Sibling message too long (%u bytes), dropping", len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Runs in the ring internal task: a short wait for a slow component,
+    // then the message is dropped instead of stalling the ring
+    node_message_t *m = node_message_alloc(NODE_MESSAGE_POOL_SIBLING, pdMS_TO_TICKS(NODE_SIBLING_ALLOC_WAIT_MS));
+    if (m == NULL) {
+        portENTER_CRITICAL(&message_lock);
+        uint32_t drops = ++sibling_drops;
+        portEXIT_CRITICAL(&message_lock);
+        ESP_LOGW(TAG, "No buffer for sibling message (%u bytes), dropping (%" PRIu32 " dropped)", len, drops);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(m->data, msg, len);
+    m->length = len;
 
     xQueueSend(sibling_message_queue, &m, portMAX_DELAY);
+    return ESP_OK;
+}
+
+uint32_t node_get_sibling_drops(void) {
+    portENTER_CRITICAL(&message_lock);
+    uint32_t drops = sibling_drops;
+    portEXIT_CRITICAL(&message_lock);
+    return drops;
 }
 
 void node_register_wireless_callbacks(wireless_callbacks_t callbacks, void *context){
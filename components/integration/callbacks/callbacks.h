@@ -2,6 +2,7 @@
 #define _CALLBACKS_H_
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 #include "wireless/wireless.h"
 #include "siblings/siblings.h"
 
@@ -14,6 +15,26 @@ typedef enum peer_type {
   PEER_CLIENT = 0
 } peer_type_t;
 
+#define NODE_MESSAGE_MAX_SIZE 520      // a whole ring_share message plus its component byte
+#define NODE_PEER_POOL_SIZE 4          // includes the buffer each TCP read loop holds while waiting
+#define NODE_SIBLING_POOL_SIZE 6
+#define NODE_SIBLING_ALLOC_WAIT_MS 20  // longest stall of the ring internal task before a message is dropped
+
+// Each source has its own pool, so a busy TCP link never takes the buffers of the ring
+typedef enum node_message_pool {
+  NODE_MESSAGE_POOL_PEER = 0,
+  NODE_MESSAGE_POOL_SIBLING,
+  NODE_MESSAGE_POOLS
+} node_message_pool_t;
+
+// Message buffer from a pool, passed by pointer up to the component callbacks
+typedef struct node_message {
+  uint16_t length;
+  uint8_t refs;
+  uint8_t pool;
+  uint8_t data[NODE_MESSAGE_MAX_SIZE];
+} node_message_t;
+
 // Init
 esp_err_t node_init_event_queues(void);
 esp_err_t node_start_event_tasks(void);
@@ -26,11 +47,17 @@ void node_register_siblings_callbacks(siblings_callback_t callback, void *contex
 wireless_t *node_get_wireless_instance(void);
 siblings_t *node_get_siblings_instance(void);
 
+// Message pools: a buffer returns to its pool when its last reference is dropped
+node_message_t *node_message_alloc(node_message_pool_t pool, TickType_t ticks);
+void node_message_ref(node_message_t *m);
+void node_message_unref(node_message_t *m);
+
 // Callback wrappers for module interconnection
 void node_on_peer_connected(uint32_t net, uint32_t mask, peer_type_t peer_type);
 void node_on_peer_lost(uint32_t net, uint32_t mask, peer_type_t peer_type);
-void node_on_peer_message(void *msg, uint16_t len);
-void node_on_sibling_message(void *msg, uint16_t len);
+void node_on_peer_message(node_message_t *m);  // takes the caller's reference
+esp_err_t node_on_sibling_message(const void *msg, uint16_t len);  // ESP_ERR_NO_MEM if no buffer freed up in time and the message was dropped
+uint32_t node_get_sibling_drops(void);  // sibling messages dropped since boot
 
 #ifdef __cplusplus
 }
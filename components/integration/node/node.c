@@ -212,14 +212,18 @@ bool node_is_device_center_root(void){
   return node_ptr->node_device_is_center_root;
 }
 
-bool node_broadcast_to_siblings(const uint8_t *msg, uint16_t len) {
-  for (int i = 0; i < MAX_RETRIES; i++) {
-    if (broadcast_to_siblings(msg, len)) {
-      return true;
-    }
-    vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
-  }
-  return false;
+bool node_broadcast_to_siblings(const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream) {
+  // Los reintentos y el orden de cada stream los mantiene la capa del anillo
+  return broadcast_to_siblings(msg, len, (broadcast_lane_t)lane, stream);
+}
+
+bool node_broadcast_to_siblings_async(const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream, node_broadcast_done_t done, void *ctx) {
+  return broadcast_to_siblings_async(msg, len, (broadcast_lane_t)lane, stream, done, ctx) == ESP_OK;
+}
+
+bool node_send_to_sibling_async(node_device_orientation_t dst, const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream, node_broadcast_done_t done, void *ctx) {
+  // Las orientaciones del nodo coinciden con los config_id_t del anillo
+  return unicast_to_sibling_async((config_id_t)dst, msg, len, (broadcast_lane_t)lane, stream, done, ctx) == ESP_OK;
 }
 
 bool node_send_wireless_message(const uint8_t *msg, uint16_t len) {
@@ -48,9 +48,18 @@ const char *node_get_link_name(void); // Returns the name of device's current wi
 int64_t node_get_device_uptime_minutes(void); // Returns the amount of time (in minutes) that the device has been initialized
 uint8_t node_get_device_channel(void); // Returns the device's currently assigned channel
 
+// Queue a sibling message waits in, the values match the ones of the ring layer
+typedef enum {
+    NODE_LANE_CONTROL = 0, // Short coordination messages, sent first
+    NODE_LANE_BULK,        // Larger refreshes, never take the last broadcast slot
+} node_lane_t;
+
 // Node communication functions
 bool node_send_wireless_message(const uint8_t *msg, uint16_t len); // Send a wireless message to the other side of the wireless link between two devices of different nodes
-bool node_broadcast_to_siblings(const uint8_t *msg, uint16_t len); // Broadcast a message to all devices of the same node
+bool node_broadcast_to_siblings(const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream); // Broadcast a message to all devices of the same node, after the earlier ones of its stream
+typedef void (*node_broadcast_done_t)(void *ctx, bool delivered); // Outcome of an asynchronous broadcast, must not block
+bool node_broadcast_to_siblings_async(const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream, node_broadcast_done_t done, void *ctx); // Queue a broadcast without waiting, retried by the ring layer
+bool node_send_to_sibling_async(node_device_orientation_t dst, const uint8_t *msg, uint16_t len, node_lane_t lane, uint8_t stream, node_broadcast_done_t done, void *ctx); // Queue a message for one device of the same node, acknowledged if done is given
 
 // Node network interfaces
 esp_netif_t *node_get_wifi_netif(void); // Returns network interface for wireless link
@@ -1,5 +1,7 @@
+#include <string.h>
 #include "node.h"
 #include "routing_hooks.h"
+#include "ring_link_netif.h"
 #include "esp_log.h"
 
 static const char *TAG = "ROUTING";
@@ -108,10 +110,34 @@ static struct netif *routing_hook_custom(uint32_t src_ip, uint32_t dst_ip) {
     return routing_hook_default(src_ip, dst_ip);
 }
 
+// Sibling that will route a packet sent through SPI, so the devices in between
+// can forward the frame without taking it up to lwIP
+static config_id_t routing_ring_dst_resolver(const uint8_t *packet, size_t len) {
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)packet;
+    ip4_addr_t dest;
+
+    if (len < IP_HLEN || IPH_V(iphdr) != 4) {
+        return CONFIG_ID_ANY;
+    }
+    memcpy(&dest, &iphdr->dest, sizeof(dest));
+    uint32_t dst_ip = lwip_ntohl(ip4_addr_get_u32(&dest));
+    if (node_is_point_to_point_message(dst_ip)) {
+        return CONFIG_ID_ANY;
+    }
+
+    orientation_t output = rt_route_output(rt, dst_ip);
+    if (output == rt->orientation || output < ORIENTATION_NORTH || output > ORIENTATION_CENTER) {
+        return CONFIG_ID_ANY;
+    }
+    return (config_id_t)(output - ORIENTATION_NORTH);  // same order as config_id_t, NORTH..CENTER
+}
+
 void node_set_routing_hook(routing_hook_type_t hook) {
     if (hook < ROUTING_HOOK_COUNT) {
         ESP_LOGD(TAG, "Setting routing hook -> valid index, updating selected hook");
         selected_routing_hook = routing_hooks[hook];
+        // The routing table is only valid once a routing role is selected
+        ring_link_netif_set_dst_resolver(hook == ROUTING_HOOK_CUSTOM ? NULL : routing_ring_dst_resolver);
     } else {
         ESP_LOGD(TAG, "Setting routing hook -> invalid index, using default hook");
         selected_routing_hook = routing_hook_default;
@@ -16,6 +16,12 @@
 #define TASK_SPI_STACK       4096
 #define TASK_SPI_PRIORITY    HIGH_PRIORITY
 
+// Simulated link tasks (Linux target)
+
+#define TASK_SIM_LINK_CORE        1
+#define TASK_SIM_LINK_STACK       4096
+#define TASK_SIM_LINK_PRIORITY    HIGH_PRIORITY
+
 // Ring Link Layer tasks
 
 #define TASK_RING_LINK_CORE        1
@@ -26,9 +32,25 @@
 #define TASK_RING_LINK_NETIF_STACK        4096
 #define TASK_RING_LINK_NETIF_PRIORITY     MID_PRIORITY
 
+#define TASK_RING_LINK_NETIF_TX_CORE      1  // takes lwIP output off the tcpip thread (CPU0)
+#define TASK_RING_LINK_NETIF_TX_STACK     4096
+#define TASK_RING_LINK_NETIF_TX_PRIORITY  MID_PRIORITY
+
 #define TASK_RING_LINK_INTERNAL_CORE      1
 #define TASK_RING_LINK_INTERNAL_STACK     4096
-#define TASK_RING_LINK_INTERNAL_PRIORITY  LOW_PRIORITY
+#define TASK_RING_LINK_INTERNAL_PRIORITY  (MID_PRIORITY + 1)  // control plane runs ahead of netif
+
+#define TASK_RING_LINK_BROADCAST_CORE     1
+#define TASK_RING_LINK_BROADCAST_STACK    2048
+#define TASK_RING_LINK_BROADCAST_PRIORITY (MID_PRIORITY + 1)
+
+#define TASK_RING_LINK_TX_CORE            1
+#define TASK_RING_LINK_TX_STACK           4096
+#define TASK_RING_LINK_TX_PRIORITY        HIGH_PRIORITY
+
+#define TASK_RING_LINK_CREDIT_CORE        1
+#define TASK_RING_LINK_CREDIT_STACK       2048
+#define TASK_RING_LINK_CREDIT_PRIORITY    MID_PRIORITY
 
 // Info Manager tasks
 
@@ -8,8 +8,18 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Received frames dropped per class since boot.
+ */
+typedef struct {
+    uint32_t lowlevel[RING_LINK_RX_CLASSES];  // lowlevel RX queue full when the transfer completed
+    uint32_t consumer[RING_LINK_RX_CLASSES];  // internal or esp_netif queue full at dispatch
+} ring_link_rx_drops_t;
+
 esp_err_t ring_link_init(void);
 
+void ring_link_get_rx_drops(ring_link_rx_drops_t *drops);
+
 
 #ifdef __cplusplus
 }
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "task_config.h"
@@ -5,21 +7,70 @@
 
 static const char *TAG = "==> ring_link";
 
-static QueueHandle_t *lowlevel_queue;
+#define RING_LINK_RX_BURST 8  // data frames taken per dispatch round
+#define RING_LINK_RX_DROPS_LOG_MS 10000  // period of the drop counters report
+
+static QueueHandle_t *lowlevel_queues;  // one per ring_link_rx_class_t
 static QueueHandle_t *internal_queue;
 static QueueHandle_t *esp_netif_queue;
+static uint32_t s_dropped[RING_LINK_RX_CLASSES];  // consumer queue full, only touched by the dispatcher
 
-static esp_err_t process_payload(ring_link_payload_t *p)
+// Politica de descarte: el despachador nunca espera a un consumidor, el frame
+// que no entra en su cola se descarta. Se avisa en 1, 2, 4, 8... descartes.
+static void drop_payload(ring_link_payload_t *p, ring_link_rx_class_t rx_class)
+{
+    uint32_t dropped = ++s_dropped[rx_class];
+    if ((dropped & (dropped - 1)) == 0) {
+        ESP_LOGW(TAG, "%s queue full, %lu payloads dropped so far",
+                 rx_class == RING_LINK_RX_CLASS_CONTROL ? "Internal" : "esp_netif", (unsigned long)dropped);
+    }
+    ring_link_lowlevel_free_rx_buffer(p);
+}
+
+// Despacha un payload ya validado, recibido solo o desempaquetado de un agregado
+static esp_err_t dispatch_payload(ring_link_payload_t *p)
 {
     QueueHandle_t *specific_queue;
 
-    uint32_t expected = ring_link_compute_crc32(p);
-    if (expected != p->crc32) {
-        ESP_LOGD(TAG, "CRC32 mismatch, dropping.");
-        ring_link_lowlevel_free_rx_buffer(p);
+    // Se descarta antes de registrar su secuencia, asi el emisor lo retransmite
+    if (ring_link_payload_is_internal(p) && uxQueueSpacesAvailable(*internal_queue) == 0)
+    {
+        drop_payload(p, RING_LINK_RX_CLASS_CONTROL);
         return ESP_FAIL;
     }
 
+    if (!ring_link_retransmit_receive(p))
+    {
+        ESP_LOGD(TAG, "Duplicate internal payload (id=%i,seq=%u), dropping.", p->id, p->ctl_seq);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_OK;
+    }
+
+    if (ring_link_payload_is_esp_netif(p) && !ring_link_payload_is_for_device(p))
+    {
+        // IP para otro hermano: se reenvia sin pasar por lwIP
+        ESP_LOGD(TAG, "Forwarding esp_netif payload to %d", p->dst_id);
+        if (!ring_link_payload_is_from_device(p)) {
+            ring_link_lowlevel_forward_payload(p);
+        }
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_OK;
+    }
+
+    // Solo se rearma lo que se consume aca. Un broadcast ajeno sigue viaje
+    // fragmento a fragmento; el mensaje rearmado ya no se reenvia
+    if ((p->flags & RING_LINK_PAYLOAD_FLAG_FRAGMENT)
+        && (ring_link_payload_is_broadcast(p) || ring_link_payload_is_for_device(p)))
+    {
+        if (ring_link_payload_is_broadcast(p) && !ring_link_payload_is_from_device(p)) {
+            ring_link_lowlevel_forward_payload(p);
+        }
+        p = ring_link_fragment_receive(p);
+        if (p == NULL) {
+            return ESP_OK;
+        }
+    }
+
     if (ring_link_payload_is_internal(p))
     {
         ESP_LOGD(TAG, "Processing as internal payload");
@@ -36,25 +87,112 @@ static esp_err_t process_payload(ring_link_payload_t *p)
         ring_link_lowlevel_free_rx_buffer(p);
         return ESP_FAIL;
     }
-    if (xQueueSend(*specific_queue, &p, pdMS_TO_TICKS(100)) != pdTRUE) {
-        ESP_LOGW(TAG, "Queue full, payload dropped");
-        ring_link_lowlevel_free_rx_buffer(p);
+    if (xQueueSend(*specific_queue, &p, 0) != pdTRUE) {
+        drop_payload(p, ring_link_payload_rx_class(p));
         return ESP_FAIL;
     }
     return ESP_OK;
 }
 
+static esp_err_t process_payload(ring_link_payload_t *p)
+{
+    if (!ring_link_payload_header_is_valid(p)) {
+        ESP_LOGD(TAG, "Header CRC32 mismatch, dropping.");
+        ring_link_credit_rx_error();
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_FAIL;
+    }
+    ring_link_credit_receive(p);
+
+    // El IP para otro hermano sigue con el CRC de origen, lo verifica el destino
+    bool cut_through = ring_link_payload_is_esp_netif(p) && !ring_link_payload_is_for_device(p);
+    if (!cut_through && !ring_link_payload_data_is_valid(p)) {
+        ESP_LOGD(TAG, "Data CRC32 mismatch, dropping.");
+        // Un IP que ya viajo varios saltos pudo dañarse en otro enlace
+        if (!ring_link_payload_is_esp_netif(p) || p->hop_src == p->src_id) {
+            ring_link_credit_rx_error();
+        }
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_FAIL;
+    }
+    p->flags |= RING_LINK_PAYLOAD_FLAG_DATA_CRC;
+    if (ring_link_payload_is_link_state(p) || ring_link_payload_is_training(p))
+    {
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_OK;
+    }
+
+    if (ring_link_payload_is_aggregate(p))
+    {
+        ring_link_payload_t *sub;
+        size_t offset = 0;
+        while ((sub = ring_link_aggregate_unpack(p, &offset)) != NULL) {
+            dispatch_payload(sub);
+        }
+        ring_link_lowlevel_free_rx_buffer(p);
+        return ESP_OK;
+    }
+
+    return dispatch_payload(p);
+}
+
+// Informa los contadores de descarte si cambiaron desde el ultimo informe
+static void log_rx_drops(void)
+{
+    static ring_link_rx_drops_t last;
+    ring_link_rx_drops_t now;
+
+    ring_link_get_rx_drops(&now);
+    if (memcmp(&now, &last, sizeof(now)) == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "RX drops: lowlevel control=%lu data=%lu, consumer control=%lu data=%lu",
+             (unsigned long)now.lowlevel[RING_LINK_RX_CLASS_CONTROL],
+             (unsigned long)now.lowlevel[RING_LINK_RX_CLASS_DATA],
+             (unsigned long)now.consumer[RING_LINK_RX_CLASS_CONTROL],
+             (unsigned long)now.consumer[RING_LINK_RX_CLASS_DATA]);
+    last = now;
+}
+
+// El driver ya clasifico cada frame al completarlo y avisa con una
+// notificacion. En cada ronda se vacia la cola de control (internos, estado
+// del enlace y agregados) y se toma una rafaga de datos, hasta vaciar ambas.
+// Cada RING_LINK_RX_DROPS_LOG_MS se informan los descartes.
 static void ring_link_process_task(void *pvParameters)
 {
-    ring_link_payload_t *payload;
-    esp_err_t rc;
-    
+    ring_link_payload_t *p;
+    size_t count;
+    TickType_t last_log = xTaskGetTickCount();
+
     while (true) {
-        if (xQueueReceive(*lowlevel_queue, &payload, portMAX_DELAY) == pdTRUE) {
-            rc = process_payload(payload);
-            // ESP_ERROR_CHECK_WITHOUT_ABORT(rc);
-            taskYIELD();
+        do {
+            count = 0;
+            while (xQueueReceive(lowlevel_queues[RING_LINK_RX_CLASS_CONTROL], &p, 0) == pdTRUE) {
+                process_payload(p);
+                count++;
+            }
+            for (size_t i = 0; i < RING_LINK_RX_BURST
+                 && xQueueReceive(lowlevel_queues[RING_LINK_RX_CLASS_DATA], &p, 0) == pdTRUE; i++) {
+                process_payload(p);
+                count++;
+            }
+        } while (count > 0);
+
+        TickType_t elapsed = xTaskGetTickCount() - last_log;
+        if (elapsed >= pdMS_TO_TICKS(RING_LINK_RX_DROPS_LOG_MS)) {
+            log_rx_drops();
+            last_log += elapsed;
+            elapsed = 0;
         }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RING_LINK_RX_DROPS_LOG_MS) - elapsed);
+    }
+}
+
+void ring_link_get_rx_drops(ring_link_rx_drops_t *drops)
+{
+    for (int i = 0; i < RING_LINK_RX_CLASSES; i++) {
+        drops->lowlevel[i] = ring_link_lowlevel_rx_dropped(i);
+        drops->consumer[i] = s_dropped[i];
     }
 }
 
@@ -69,24 +207,30 @@ esp_err_t ring_link_init(void)
     printf("CONFIG_RING_LINK_LOWLEVEL_IMPL_UART\n");
     #endif
 
+    #ifdef CONFIG_RING_LINK_LOWLEVEL_IMPL_SIM
+    printf("CONFIG_RING_LINK_LOWLEVEL_IMPL_SIM\n");
+    #endif
+
 
-    ESP_ERROR_CHECK(ring_link_lowlevel_init(&lowlevel_queue));
+    ESP_ERROR_CHECK(ring_link_lowlevel_init(&lowlevel_queues));
     ESP_ERROR_CHECK(ring_link_internal_init(&internal_queue));
     ESP_ERROR_CHECK(ring_link_netif_init(&esp_netif_queue));
 
+    TaskHandle_t process_task;
     BaseType_t ret = xTaskCreatePinnedToCore(
         ring_link_process_task,
         "ring_link_process",
         TASK_RING_LINK_STACK,
         NULL,
         TASK_RING_LINK_PRIORITY,
-        NULL,
+        &process_task,
         TASK_RING_LINK_CORE
     );
     if (ret != pdTRUE) {
         ESP_LOGE(TAG, "Failed to create process task");
         return ESP_FAIL;
     }
+    ring_link_lowlevel_set_rx_task(process_task);
     
     return ESP_OK;
 }
@@ -1,77 +1,468 @@
 #include "broadcast.h"
 
+#include <stdlib.h>
+#include "freertos/semphr.h"
+#include "task_config.h"
+
 static const char* TAG = "==> broadcast";
-static SemaphoreHandle_t s_broadcast_mutex = NULL;
+
+typedef struct broadcast_request {
+    struct broadcast_request *next;  // next one of the same stream
+    broadcast_done_cb_t done;
+    void *ctx;
+    config_id_t dst_id;        // CONFIG_ID_ALL for a broadcast
+    bool ack;                  // unicast completed by the ACK of its destination
+    broadcast_lane_t lane;
+    uint8_t stream;
+    uint16_t len;
+    uint8_t msg[];
+} broadcast_request_t;
+
+// Mensajes en espera de un stream, en orden de llegada
+typedef struct {
+    broadcast_request_t *head;
+    broadcast_request_t *tail;
+    bool busy;                 // one of its messages holds a window slot
+} broadcast_stream_t;
+
+typedef struct {
+    broadcast_request_t *req;  // NULL if the slot is free
+    ring_link_payload_id_t id;
+    uint8_t tries;
+    bool returned;             // the frame came back or was acknowledged, set by the handlers
+    bool backoff;              // waiting to send the next try
+    TickType_t since;          // start of the current try or backoff
+    TickType_t period;         // its length
+} broadcast_slot_t;
+
+static broadcast_stream_t s_streams[BROADCAST_STREAMS];
+static uint8_t s_waiting[BROADCAST_LANES];  // requests waiting in the streams, per lane
+static uint8_t s_stream_cursor = 0;         // where the next admission starts looking
 static TaskHandle_t s_broadcast_task = NULL;
+static portMUX_TYPE s_broadcast_lock = portMUX_INITIALIZER_UNLOCKED;
+static broadcast_slot_t s_slots[BROADCAST_WINDOW];
 static ring_link_payload_id_t s_id_counter = 0;
 
+// Ultimos mensajes entregados, por origen. Solo los toca la tarea de proceso
+typedef struct {
+    ring_link_payload_id_t ids[BROADCAST_DELIVERED_HISTORY];
+    uint8_t count;
+    uint8_t next;
+} broadcast_history_t;
+
+static broadcast_history_t s_delivered[RING_LINK_CREDIT_MAX_NODES];
+
+// El mensaje se escribe directo en un buffer del pool de TX, sin copia en la pila
+static esp_err_t send_message(ring_link_payload_id_t id, const broadcast_request_t *req){
+    uint8_t flags = req->ack ? RING_LINK_PAYLOAD_FLAG_ACK_REQ : 0;
+
+    if (req->len > RING_LINK_PAYLOAD_DATA_MAX) {
+        return ring_link_fragment_transmit(RING_LINK_PAYLOAD_TYPE_INTERNAL, id, req->dst_id, flags, req->msg, req->len);
+    }
+    ring_link_payload_t *p = ring_link_lowlevel_alloc_tx_payload();
+    if (p == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->id = id;
+    p->ttl = RING_LINK_PAYLOAD_TTL;
+    p->src_id = config_get_id();
+    p->dst_id = req->dst_id;
+    p->buffer_type = RING_LINK_PAYLOAD_TYPE_INTERNAL;
+    p->len = req->len;
+    p->ctl_seq = 0;
+    p->flags = flags;
+    memcpy(p->buffer, req->msg, req->len);
+    return ring_link_lowlevel_transmit_payload(p);
+}
+
+// Un envio que falla se trata como un intento vencido. Un unicast sin ACK
+// se da por entregado al salir: los saltos ya lo retransmiten
+static void send_try(broadcast_slot_t *slot, TickType_t now)
+{
+    broadcast_request_t *req = slot->req;
+
+    slot->tries++;
+    slot->backoff = false;
+    slot->since = now;
+    if (send_message(slot->id, req) != ESP_OK) {
+        slot->period = 0;
+    } else if (req->dst_id != CONFIG_ID_ALL && !req->ack) {
+        portENTER_CRITICAL(&s_broadcast_lock);
+        slot->returned = true;
+        portEXIT_CRITICAL(&s_broadcast_lock);
+        slot->period = 0;
+    } else {
+        slot->period = pdMS_TO_TICKS(BROADCAST_TIMEOUT_MS);
+    }
+}
+
+static void finish(broadcast_slot_t *slot, bool delivered)
+{
+    broadcast_request_t *req = slot->req;
+
+    portENTER_CRITICAL(&s_broadcast_lock);
+    slot->req = NULL;
+    s_streams[req->stream].busy = false;
+    portEXIT_CRITICAL(&s_broadcast_lock);
+
+    if (!delivered) {
+        ESP_LOGW(TAG, "Message (id=%i,dest=%i) not delivered after %u tries.", slot->id, req->dst_id, slot->tries);
+    }
+    if (req->done) {
+        req->done(req->ctx, delivered);
+    }
+    free(req);
+}
+
+// Avanza un slot ocupado; devuelve los ticks hasta que haya que volver a mirarlo
+static TickType_t update_slot(broadcast_slot_t *slot, TickType_t now)
+{
+    portENTER_CRITICAL(&s_broadcast_lock);
+    bool returned = slot->returned;
+    portEXIT_CRITICAL(&s_broadcast_lock);
+
+    if (returned) {
+        finish(slot, true);
+        return portMAX_DELAY;
+    }
+    if (now - slot->since < slot->period) {
+        return slot->period - (now - slot->since);
+    }
+    if (slot->backoff) {
+        send_try(slot, now);
+        return slot->period;
+    }
+    if (slot->tries >= BROADCAST_MAX_TRIES) {
+        finish(slot, false);
+        return portMAX_DELAY;
+    }
+    ESP_LOGD(TAG, "Message (id=%i) not confirmed, retrying.", slot->id);
+    slot->backoff = true;
+    slot->since = now;
+    slot->period = pdMS_TO_TICKS(BROADCAST_RETRY_DELAY_MS) << (slot->tries - 1);
+    return slot->period;
+}
+
+static void admit(broadcast_slot_t *slot, broadcast_request_t *req, TickType_t now)
+{
+    portENTER_CRITICAL(&s_broadcast_lock);
+    slot->req = req;
+    slot->id = s_id_counter++;
+    slot->tries = 0;
+    slot->returned = false;
+    portEXIT_CRITICAL(&s_broadcast_lock);
+    send_try(slot, now);
+}
+
+// Saca el primero de un stream libre de ese carril. Un stream con un mensaje
+// en vuelo o reintentandose espera: los siguientes no lo adelantan
+static broadcast_request_t *take_request(broadcast_lane_t lane)
+{
+    broadcast_request_t *req = NULL;
+
+    portENTER_CRITICAL(&s_broadcast_lock);
+    for (int n = 0; n < BROADCAST_STREAMS; n++) {
+        int i = (s_stream_cursor + n) % BROADCAST_STREAMS;
+        broadcast_stream_t *stream = &s_streams[i];
+
+        if (!stream->busy && stream->head != NULL && stream->head->lane == lane) {
+            req = stream->head;
+            stream->head = req->next;
+            if (stream->head == NULL) {
+                stream->tail = NULL;
+            }
+            stream->busy = true;
+            s_waiting[lane]--;
+            s_stream_cursor = (i + 1) % BROADCAST_STREAMS;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_broadcast_lock);
+    return req;
+}
+
+// Primero el carril de control; los largos dejan libre al menos un slot
+static broadcast_request_t *next_request(int bulk_in_flight)
+{
+    broadcast_request_t *req = take_request(BROADCAST_LANE_CONTROL);
+
+    if (req == NULL && (BROADCAST_WINDOW == 1 || bulk_in_flight < BROADCAST_WINDOW - 1)) {
+        req = take_request(BROADCAST_LANE_BULK);
+    }
+    return req;
+}
+
+static void broadcast_task(void *pvParameters)
+{
+    while (true) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = portMAX_DELAY;
+        int bulk_in_flight = 0;
+
+        for (int i = 0; i < BROADCAST_WINDOW; i++) {
+            broadcast_slot_t *slot = &s_slots[i];
+            TickType_t next = portMAX_DELAY;
+
+            if (slot->req != NULL) {
+                next = update_slot(slot, now);
+            }
+            if (slot->req != NULL) {
+                bulk_in_flight += slot->req->lane == BROADCAST_LANE_BULK;
+            }
+            if (next < wait) {
+                wait = next;
+            }
+        }
+        for (int i = 0; i < BROADCAST_WINDOW; i++) {
+            broadcast_slot_t *slot = &s_slots[i];
+            broadcast_request_t *req;
+
+            if (slot->req == NULL && (req = next_request(bulk_in_flight)) != NULL) {
+                admit(slot, req, now);
+                bulk_in_flight += req->lane == BROADCAST_LANE_BULK;
+                if (slot->period < wait) {
+                    wait = slot->period;
+                }
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
 esp_err_t broadcast_init( void )
 {
-    s_broadcast_mutex = xSemaphoreCreateMutex();
-    if( s_broadcast_mutex == NULL )
-    {
-        ESP_LOGE(TAG, "an error ocurred creating mutex.");
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        broadcast_task,
+        "ring_link_broadcast",
+        TASK_RING_LINK_BROADCAST_STACK,
+        NULL,
+        TASK_RING_LINK_BROADCAST_PRIORITY,
+        &s_broadcast_task,
+        TASK_RING_LINK_BROADCAST_CORE
+    );
+    if (ret != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to create broadcast task");
         return ESP_FAIL;
     }
 
     return ESP_OK;
 }
 
-static esp_err_t send_broadcast(const void *buffer, uint16_t len){
-    ring_link_payload_t p = {
-        .id = s_id_counter ++,
-        .ttl = RING_LINK_PAYLOAD_TTL,
-        .src_id = config_get_id(),
-        .dst_id = CONFIG_ID_ALL,
-        .buffer_type = RING_LINK_PAYLOAD_TYPE_INTERNAL,
-        .len = len,
-    };
+static esp_err_t queue_message(config_id_t dst_id, bool ack, const void *msg, uint16_t len,
+                               broadcast_lane_t lane, uint8_t stream, broadcast_done_cb_t done, void *ctx)
+{
     if (len > RING_LINK_NETIF_MTU) {
         ESP_LOGE(TAG, "Buffer length exceeds maximum allowed size.");
         return ESP_ERR_INVALID_SIZE;
     }
-    memcpy(p.buffer, buffer, len);
-    return ring_link_lowlevel_transmit_payload(&p);
+    if (lane >= BROADCAST_LANES || stream >= BROADCAST_STREAMS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    broadcast_request_t *req = malloc(sizeof(broadcast_request_t) + len);
+    if (req == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    req->done = done;
+    req->ctx = ctx;
+    req->dst_id = dst_id;
+    req->ack = ack;
+    req->lane = lane;
+    req->stream = stream;
+    req->next = NULL;
+    req->len = len;
+    memcpy(req->msg, msg, len);
+
+    bool queued = false;
+    portENTER_CRITICAL(&s_broadcast_lock);
+    if (s_waiting[lane] < BROADCAST_QUEUE_SIZE) {
+        broadcast_stream_t *s = &s_streams[stream];
+        if (s->tail != NULL) {
+            s->tail->next = req;
+        } else {
+            s->head = req;
+        }
+        s->tail = req;
+        s_waiting[lane]++;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&s_broadcast_lock);
+
+    if (!queued) {
+        ESP_LOGW(TAG, "Broadcast queue full, dropping message.");
+        free(req);
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotifyGive(s_broadcast_task);
+    return ESP_OK;
 }
 
-bool broadcast_to_siblings(const void *msg, uint16_t len)
+esp_err_t broadcast_to_siblings_async(const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream, broadcast_done_cb_t done, void *ctx)
 {
-    if( xSemaphoreTake( s_broadcast_mutex, ( TickType_t ) 400 ) == pdTRUE )
-    {
-        bool result = false;
-        s_broadcast_task = xTaskGetCurrentTaskHandle();
-        if (send_broadcast(msg, len) == ESP_OK)
-        {    
-            result = ulTaskNotifyTake( pdTRUE, BROADCAST_TIMEOUT_MS / portTICK_PERIOD_MS ) == pdTRUE ? true : false;
+    return queue_message(CONFIG_ID_ALL, false, msg, len, lane, stream, done, ctx);
+}
+
+esp_err_t unicast_to_sibling_async(config_id_t dst_id, const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream, broadcast_done_cb_t done, void *ctx)
+{
+    // Un mensaje a esta misma placa nunca se entrego, tampoco con broadcast
+    if (dst_id > CONFIG_ID_CENTER || dst_id == config_get_id()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return queue_message(dst_id, done != NULL, msg, len, lane, stream, done, ctx);
+}
+
+// Semaforo propio de cada llamada: las notificaciones de la tarea que espera
+// quedan para sus otros usos
+typedef struct {
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buffer;
+    bool delivered;
+} broadcast_waiter_t;
+
+static void wake_waiter(void *ctx, bool delivered)
+{
+    broadcast_waiter_t *waiter = ctx;
+
+    waiter->delivered = delivered;
+    xSemaphoreGive(waiter->done);
+}
+
+bool broadcast_to_siblings(const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream)
+{
+    broadcast_waiter_t waiter = { .delivered = false };
+
+    waiter.done = xSemaphoreCreateBinaryStatic(&waiter.done_buffer);
+    if (broadcast_to_siblings_async(msg, len, lane, stream, wake_waiter, &waiter) != ESP_OK) {
+        vSemaphoreDelete(waiter.done);
+        return false;
+    }
+    // El resultado llega siempre: los intentos y sus esperas son finitos
+    xSemaphoreTake(waiter.done, portMAX_DELAY);
+    vSemaphoreDelete(waiter.done);
+    return waiter.delivered;
+}
+
+// Marca entregado el mensaje en vuelo con ese id
+static bool complete_slot(ring_link_payload_id_t id)
+{
+    bool found = false;
+
+    portENTER_CRITICAL(&s_broadcast_lock);
+    for (int i = 0; i < BROADCAST_WINDOW; i++) {
+        if (s_slots[i].req != NULL && s_slots[i].id == id) {
+            s_slots[i].returned = true;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_broadcast_lock);
+
+    if (found) {
+        xTaskNotifyGive(s_broadcast_task);
+    }
+    return found;
+}
+
+static void send_ack(const ring_link_payload_t *msg)
+{
+    ring_link_payload_t *p = ring_link_lowlevel_alloc_tx_payload();
+    if (p == NULL) {
+        ESP_LOGD(TAG, "No TX buffer to acknowledge message (src=%i,id=%i).", msg->src_id, msg->id);
+        return;
+    }
+    p->id = msg->id;
+    p->ttl = RING_LINK_PAYLOAD_TTL;
+    p->src_id = config_get_id();
+    p->dst_id = msg->src_id;
+    p->buffer_type = RING_LINK_PAYLOAD_TYPE_INTERNAL;
+    p->len = 0;
+    p->flags = RING_LINK_PAYLOAD_FLAG_ACK;
+    ring_link_lowlevel_transmit_payload(p);
+}
+
+// Un reintento de un mensaje ya entregado no se entrega dos veces
+static bool is_delivered(const ring_link_payload_t *p)
+{
+    if (p->src_id >= RING_LINK_CREDIT_MAX_NODES) {
+        return false;
+    }
+    broadcast_history_t *h = &s_delivered[p->src_id];
+    for (int i = 0; i < h->count; i++) {
+        if (h->ids[i] == p->id) {
+            return true;
         }
-        s_broadcast_task = NULL;
-        xSemaphoreGive( s_broadcast_mutex );
-        return result;
     }
-    ESP_LOGE(TAG, "Could not adquire Mutex...");
     return false;
 }
 
+static void set_delivered(const ring_link_payload_t *p)
+{
+    if (p->src_id >= RING_LINK_CREDIT_MAX_NODES) {
+        return;
+    }
+    broadcast_history_t *h = &s_delivered[p->src_id];
+    h->ids[h->next] = p->id;
+    h->next = (h->next + 1) % BROADCAST_DELIVERED_HISTORY;
+    if (h->count < BROADCAST_DELIVERED_HISTORY) {
+        h->count++;
+    }
+}
+
+esp_err_t unicast_handler(ring_link_payload_t *p)
+{
+    if (p->flags & RING_LINK_PAYLOAD_FLAG_ACK) {
+        if (!complete_slot(p->id)) {
+            ESP_LOGD(TAG, "Late ACK (src=%i,id=%i), ignoring.", p->src_id, p->id);
+        }
+        return ESP_OK;
+    }
+    if (p->flags & RING_LINK_PAYLOAD_FLAG_ACK_REQ) {
+        if (is_delivered(p)) {
+            ESP_LOGD(TAG, "Retried message (src=%i,id=%i) already delivered.", p->src_id, p->id);
+            send_ack(p);
+            return ESP_OK;
+        }
+        // Solo se confirma lo entregado; sin ACK el origen lo reintenta
+        esp_err_t rc = ring_link_internal_process(p);
+        if (rc != ESP_OK) {
+            ESP_LOGW(TAG, "Message (src=%i,id=%i) not delivered, not acknowledging it.", p->src_id, p->id);
+            return rc;
+        }
+        set_delivered(p);
+        send_ack(p);
+        return ESP_OK;
+    }
+    return ring_link_internal_process(p);
+}
+
 esp_err_t broadcast_handler(ring_link_payload_t *p)
 {
     // broadcast origin
     if (ring_link_payload_is_from_device(p))
     {
-        if (!s_broadcast_task) {
+        if (!complete_slot(p->id)) {
             ESP_LOGW(
                 TAG, "Broadcast (src=%i,dest=%i,id=%i,ttl=%i) took too long -- dropping",
                 p->src_id, p->dst_id, p->id, p->ttl
             );
         } else {
             ESP_LOGD(TAG, "Broadcast complete (src=%i,dest=%i,id=%i,ttl=%i).", p->src_id, p->dst_id, p->id, p->ttl);
-            xTaskNotifyGive( s_broadcast_task );
         }
         return ESP_OK;
     }
     else
     {
-        ESP_ERROR_CHECK(ring_link_internal_process(p));
+        if (is_delivered(p)) {
+            ESP_LOGD(TAG, "Retried broadcast (src=%i,id=%i) already delivered.", p->src_id, p->id);
+            return ring_link_lowlevel_forward_payload(p);
+        }
+        // Sin entregar no se reenvia: el origen no lo ve volver y lo reintenta
+        esp_err_t rc = ring_link_internal_process(p);
+        if (rc != ESP_OK) {
+            ESP_LOGW(TAG, "Broadcast (src=%i,id=%i) not delivered, holding it back.", p->src_id, p->id);
+            return rc;
+        }
+        set_delivered(p);
         return ring_link_lowlevel_forward_payload(p);
     }
 }
-
@@ -7,12 +7,73 @@ extern "C" {
 #endif
 
 #define BROADCAST_TIMEOUT_MS 500
+#define BROADCAST_WINDOW CONFIG_RING_LINK_BROADCAST_WINDOW  // broadcasts travelling the ring at once
+#define BROADCAST_QUEUE_SIZE 16       // broadcasts waiting for a window slot, per lane
+#define BROADCAST_STREAMS 16          // message streams kept in order, see broadcast_to_siblings_async
+#define BROADCAST_MAX_TRIES 5
+#define BROADCAST_RETRY_DELAY_MS 50   // wait before the second try, doubled on each of the next ones
+#define BROADCAST_DELIVERED_HISTORY 16  // delivered messages remembered per source, to drop retried copies
 
+/**
+ * @brief Called once a broadcast came back to this board (delivered) or ran
+ * out of tries. Runs in the broadcast task, so it must not block.
+ */
+typedef void (*broadcast_done_cb_t)(void *ctx, bool delivered);
+
+/**
+ * @brief Queue of a message, chosen by the sender. Control messages are
+ * admitted first and bulk ones never take the last free window slot.
+ */
+typedef enum {
+    BROADCAST_LANE_CONTROL = 0,
+    BROADCAST_LANE_BULK,
+    BROADCAST_LANES,
+} broadcast_lane_t;
 
 esp_err_t broadcast_init( void );
 esp_err_t broadcast_handler(ring_link_payload_t *p);
+esp_err_t unicast_handler(ring_link_payload_t *p);
+
+/**
+ * @brief Queues a message for every board of the node and returns at once.
+ *
+ * The message is copied. The broadcast task sends it when one of the
+ * BROADCAST_WINDOW slots is free; broadcasts in flight are told apart by
+ * their payload id and complete on their own when their frame returns to
+ * this board. A frame not back within BROADCAST_TIMEOUT_MS is sent again,
+ * after a backoff, up to BROADCAST_MAX_TRIES times.
+ *
+ * Messages of the same stream, unicasts included, hold one slot at a time:
+ * a message is not sent until the previous one of its stream completed or
+ * ran out of tries, so a retried message is never overtaken.
+ *
+ * @param lane Queue the message waits in.
+ * @param stream Below BROADCAST_STREAMS, picked by the sender.
+ * @param done Optional, reports the outcome.
+ * @return ESP_ERR_NO_MEM if the queue is full.
+ */
+esp_err_t broadcast_to_siblings_async(const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream, broadcast_done_cb_t done, void *ctx);
+
+/**
+ * @brief Same as broadcast_to_siblings_async, waiting for the outcome.
+ *
+ * Must not be called from the ring link tasks, which complete the broadcast.
+ *
+ * @return true if the message came back to this board.
+ */
+bool broadcast_to_siblings(const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream);
 
-bool broadcast_to_siblings(const void *msg, uint16_t len);
+/**
+ * @brief Queues a message for a single board of the node and returns at once.
+ *
+ * The frame stops at its destination instead of travelling the whole ring.
+ * With `done`, the destination acknowledges the message and it is retried
+ * like a broadcast until the ACK arrives; without it the message is sent
+ * once, relying on the per-link retransmissions.
+ *
+ * @return ESP_ERR_INVALID_ARG for this board itself or a non-device id.
+ */
+esp_err_t unicast_to_sibling_async(config_id_t dst_id, const void *msg, uint16_t len, broadcast_lane_t lane, uint8_t stream, broadcast_done_cb_t done, void *ctx);
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,11 @@ extern "C" {
 #endif
 
 esp_err_t ring_link_internal_init(QueueHandle_t **queue);
+/**
+ * @brief Hands an internal message to the routing components.
+ *
+ * @return ESP_OK once it is queued for them, an error if it was dropped.
+ */
 esp_err_t ring_link_internal_process(ring_link_payload_t *p);
 
 #ifdef __cplusplus
@@ -14,7 +14,7 @@ static esp_err_t ring_link_internal_handler(ring_link_payload_t *p)
     }
     else if (ring_link_payload_is_for_device(p))  // payload for me
     {
-        return ring_link_internal_process(p);
+        return unicast_handler(p);
     }
     else  // not for me, forwarding
     {
@@ -68,6 +68,5 @@ esp_err_t ring_link_internal_init(QueueHandle_t **queue)
 
 esp_err_t ring_link_internal_process(ring_link_payload_t *p)
 {
-    node_on_sibling_message(p->buffer, p->len);
-    return ESP_OK;
+    return node_on_sibling_message(p->buffer, p->len);
 }
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "esp_err.h"
+#include "ring_link_payload.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_AGGREGATE_SUB_POOL 16  // unpacked sub-payloads alive at once
+
+/**
+ * @brief Header of each sub-payload packed in an AGGREGATE frame.
+ *
+ * Same fields as the payload header, minus the per-hop ones, which the
+ * sub-payloads take from the frame that carries them.
+ */
+typedef struct {
+    ring_link_payload_id_t id;
+    ring_link_payload_buffer_type_t buffer_type;
+    uint8_t ttl;
+    uint16_t len;
+    config_id_t src_id;
+    config_id_t dst_id;
+    uint8_t ctl_seq;
+    uint8_t flags;
+    uint8_t reserved[2];  // keeps the data that follows word aligned
+} ring_link_aggregate_header_t;
+
+/**
+ * @brief Creates the fixed pool the sub-payloads are unpacked into.
+ */
+esp_err_t ring_link_aggregate_init(void);
+
+/**
+ * @brief Tells whether p is a buffer of the sub-payload pool.
+ */
+bool ring_link_aggregate_is_sub_payload(const void *p);
+
+/**
+ * @brief Returns a sub-payload to its pool. Use ring_link_lowlevel_free_rx_buffer,
+ * which calls it.
+ */
+void ring_link_aggregate_free_sub_payload(ring_link_payload_t *p);
+
+/**
+ * @brief Tells whether a frame is small enough to be packed with others.
+ */
+bool ring_link_aggregate_is_candidate(ring_link_payload_t *p);
+
+/**
+ * @brief Turns a TX payload into an empty AGGREGATE frame.
+ */
+void ring_link_aggregate_start(ring_link_payload_t *agg);
+
+/**
+ * @brief Tells whether p still fits at the end of agg.
+ */
+bool ring_link_aggregate_fits(const ring_link_payload_t *agg, const ring_link_payload_t *p);
+
+/**
+ * @brief Packs p at the end of agg.
+ *
+ * @return false, leaving agg untouched, if p does not fit.
+ */
+bool ring_link_aggregate_append(ring_link_payload_t *agg, const ring_link_payload_t *p);
+
+/**
+ * @brief Copies the sub-payload found at *offset into a standalone payload.
+ *
+ * The copy is taken from a fixed pool of RING_LINK_AGGREGATE_SUB_POOL buffers
+ * sized for CONFIG_RING_LINK_AGGREGATE_MAX_LEN bytes of data. It carries the
+ * hop fields of agg and is released with ring_link_lowlevel_free_rx_buffer,
+ * like any received payload.
+ *
+ * @param[in,out] offset Position in agg->buffer, start at 0.
+ * @return NULL at the end of agg, on a malformed sub-payload or with the pool empty.
+ */
+ring_link_payload_t *ring_link_aggregate_unpack(const ring_link_payload_t *agg, size_t *offset);
+
+#ifdef __cplusplus
+}
+#endif
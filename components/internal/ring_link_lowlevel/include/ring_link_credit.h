@@ -0,0 +1,97 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ring_link_payload.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_CREDIT_RESERVE      1    // RX buffers kept for internal frames
+#define RING_LINK_CREDIT_MAX_IN_FLIGHT 64  // beyond this the downstream record is out of sync
+#define RING_LINK_CREDIT_KEEPALIVE_MS (CONFIG_RING_LINK_CREDIT_STALE_MS / 3)
+
+#ifdef CONFIG_RING_LINK_CREDIT
+#define RING_LINK_CREDIT_WAIT_MS CONFIG_RING_LINK_CREDIT_WAIT_MS
+#define RING_LINK_CREDIT_STATE_MIN_MS CONFIG_RING_LINK_CREDIT_STATE_MIN_MS
+#else
+#define RING_LINK_CREDIT_WAIT_MS 20  // never used: without credits nothing is held
+#define RING_LINK_CREDIT_STATE_MIN_MS 10
+#endif
+
+// Least gap between two LINK_STATE frames, at least one tick
+#define RING_LINK_CREDIT_STATE_MIN_TICKS \
+    (pdMS_TO_TICKS(RING_LINK_CREDIT_STATE_MIN_MS) > 0 ? pdMS_TO_TICKS(RING_LINK_CREDIT_STATE_MIN_MS) : 1)
+
+/**
+ * @brief Starts the task that advertises this board's receive state.
+ */
+esp_err_t ring_link_credit_init(void);
+
+/**
+ * @brief Fills the hop fields and the credit records of a frame about to be sent.
+ *
+ * Only called by the TX scheduler task, right before the frame is sealed.
+ */
+void ring_link_credit_stamp(ring_link_payload_t *p);
+
+/**
+ * @brief Merges the credit records carried by a frame received from upstream.
+ */
+void ring_link_credit_receive(const ring_link_payload_t *p);
+
+/**
+ * @brief Signals that this board's own record changed (an RX buffer went back
+ * to the lowlevel pool or the acknowledgement moved).
+ */
+void ring_link_credit_changed(void);
+
+/**
+ * @brief Tells whether the downstream neighbour can take another data frame.
+ *
+ * If the neighbour's record is unknown or stale the link is treated as
+ * unlimited, which is how the ring behaved without credits.
+ */
+bool ring_link_credit_available(void);
+
+/**
+ * @brief Counts a frame received from upstream with a bad CRC.
+ */
+void ring_link_credit_rx_error(void);
+
+/**
+ * @brief Damaged frames the downstream neighbour got from this board, as
+ * reported by its record. The count wraps around.
+ *
+ * @return false if its record is unknown or stale.
+ */
+bool ring_link_credit_downstream_errors(uint16_t *rx_errors);
+
+/**
+ * @brief Tells whether a fresh record of the downstream neighbour is known.
+ */
+bool ring_link_credit_downstream_known(void);
+
+/**
+ * @brief Asks board `src` to resend the full headers of its compression
+ * contexts, or withdraws the request. Carried in this board's record.
+ */
+void ring_link_credit_set_refresh(config_id_t src, bool requested);
+
+/**
+ * @brief Tells whether `board` asks this board to resend its full headers.
+ * CONFIG_ID_ANY stands for the downstream neighbour.
+ */
+bool ring_link_credit_refresh_requested(config_id_t board);
+
+/**
+ * @brief Sets the task notified whenever the downstream neighbour's record changes.
+ */
+void ring_link_credit_set_tx_task(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
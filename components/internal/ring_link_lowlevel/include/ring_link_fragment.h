@@ -0,0 +1,77 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#include "ring_link_payload.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_FRAGMENT_SLOTS      4   // messages reassembled at the same time
+#define RING_LINK_FRAGMENT_MAX        32  // fragments per message, one bit each in a slot
+#define RING_LINK_FRAGMENT_TX_WAIT_MS 20  // wait for TX room once the first fragment is sent
+
+/**
+ * @brief Header at the start of the buffer of a frame flagged RING_LINK_PAYLOAD_FLAG_FRAGMENT.
+ *
+ * The frame keeps the type, source and destination of the whole message, so
+ * it is classified, acknowledged and forwarded like any other frame.
+ */
+typedef struct {
+    uint16_t msg_id;     // per-source message counter
+    uint16_t offset;     // position of the data that follows in the message
+    uint16_t total_len;  // length of the whole message
+    uint16_t reserved;   // keeps the data that follows word aligned
+} ring_link_fragment_header_t;
+
+#define RING_LINK_FRAGMENT_DATA_MAX (RING_LINK_PAYLOAD_DATA_MAX - sizeof(ring_link_fragment_header_t))
+
+/**
+ * @brief Copies len bytes of a message, starting at offset, into dst.
+ *
+ * Lets a message stored in pieces (a pbuf chain) be written straight into
+ * the frames, without first making it contiguous.
+ */
+typedef void (*ring_link_fragment_gather_t)(void *ctx, size_t offset, void *dst, size_t len);
+
+/**
+ * @brief Sends a message larger than one frame as a train of fragments.
+ *
+ * The first fragment is not waited for, so a congested link rejects the whole
+ * message with ESP_ERR_NO_MEM, as it would a single frame. The rest wait up
+ * to RING_LINK_FRAGMENT_TX_WAIT_MS each for room in the TX scheduler; if one
+ * still does not fit, the receivers drop the message when it times out.
+ *
+ * @param flags Flags of the whole message, only RING_LINK_PAYLOAD_FLAG_ACK_REQ
+ *              is kept by the reassembled message.
+ */
+esp_err_t ring_link_fragment_transmit(ring_link_payload_buffer_type_t buffer_type, ring_link_payload_id_t id,
+                                      config_id_t dst_id, uint8_t flags, const void *data, size_t len);
+
+/**
+ * @brief Same as ring_link_fragment_transmit, reading the message through gather.
+ *
+ * @param wait Time the first fragment waits for room in the TX scheduler.
+ */
+esp_err_t ring_link_fragment_transmit_gather(ring_link_payload_buffer_type_t buffer_type, ring_link_payload_id_t id,
+                                             config_id_t dst_id, uint8_t flags, size_t len, TickType_t wait,
+                                             ring_link_fragment_gather_t gather, void *ctx);
+
+/**
+ * @brief Takes a received fragment and returns the message it completes.
+ *
+ * The fragment is always released. The message is allocated from the heap,
+ * flagged RING_LINK_PAYLOAD_FLAG_REASSEMBLED and released with
+ * ring_link_lowlevel_free_rx_buffer. Messages not completed within
+ * CONFIG_RING_LINK_FRAGMENT_TIMEOUT_MS are dropped. Only called by the ring
+ * link dispatcher task.
+ *
+ * @return NULL while fragments are missing.
+ */
+ring_link_payload_t *ring_link_fragment_receive(ring_link_payload_t *p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,11 @@
 #include "freertos/semphr.h"
 
 #include "ring_link_payload.h"
+#include "ring_link_credit.h"
+#include "ring_link_retransmit.h"
+#include "ring_link_aggregate.h"
+#include "ring_link_rate.h"
+#include "ring_link_fragment.h"
 #include "ring_link_lowlevel_impl.h"
 #include "config.h"
 
@@ -16,13 +21,79 @@ extern "C" {
 #endif
 
 #define RING_LINK_READ_QUEUE_SIZE 40
+#define RING_LINK_TX_QUEUE_SIZE RING_LINK_LOWLEVEL_TX_BUFFERS  // every queued frame holds a TX buffer
+#define RING_LINK_TX_CTL_RESERVE 2  // TX buffers data frames can never take
+// Queued data frames, plus the one held for credits, leave the reserve to control frames
+#define RING_LINK_TX_DATA_QUEUE_SIZE (RING_LINK_TX_QUEUE_SIZE - RING_LINK_TX_CTL_RESERVE - 1)
 
-esp_err_t ring_link_lowlevel_init(QueueHandle_t **queue);
+/**
+ * @brief Starts the lowlevel link and the TX scheduler.
+ *
+ * @param[out] queues Set to the received-frame queues, indexed by
+ *                    ring_link_rx_class_t. Frames are classified when the
+ *                    transfer completes.
+ */
+esp_err_t ring_link_lowlevel_init(QueueHandle_t **queues);
 
+/**
+ * @brief Sets the task notified each time a received frame is queued.
+ */
+void ring_link_lowlevel_set_rx_task(TaskHandle_t task);
+
+/**
+ * @brief Frames of a class dropped by the lowlevel driver because its queue was full.
+ */
+size_t ring_link_lowlevel_rx_dropped(ring_link_rx_class_t rx_class);
+
+/**
+ * @brief Takes a payload from the lowlevel DMA-capable TX pool, without waiting.
+ *
+ * A payload filled in place and passed to ring_link_lowlevel_transmit_payload
+ * reaches the bus without being copied. The transmit call gives it back to the
+ * pool whatever its result; ring_link_lowlevel_free_tx_payload is only needed
+ * when the payload is not transmitted at all.
+ *
+ * @return The payload, or NULL if every TX buffer is in use.
+ */
+ring_link_payload_t *ring_link_lowlevel_alloc_tx_payload(void);
+
+/**
+ * @brief Same as ring_link_lowlevel_alloc_tx_payload, waiting up to `ticks`
+ * for a transfer to finish and give its buffer back.
+ */
+ring_link_payload_t *ring_link_lowlevel_alloc_tx_payload_wait(TickType_t ticks);
+
+esp_err_t ring_link_lowlevel_free_tx_payload(ring_link_payload_t *p);
+
+/**
+ * @brief Hands a payload to the TX scheduler task.
+ *
+ * Never blocks: the payload is either accepted, and sent in order by the
+ * scheduler, or rejected with ESP_ERR_NO_MEM when no TX buffer is free or its
+ * lane is full. Control payloads (see ring_link_payload_is_control) go in a
+ * separate lane that is always sent before data.
+ * Payloads not taken from the TX pool are copied into one first.
+ */
 esp_err_t ring_link_lowlevel_transmit_payload(ring_link_payload_t *p);
 
+/**
+ * @brief Same as ring_link_lowlevel_transmit_payload, waiting up to `ticks`
+ * for a free TX buffer and for room in the lane before rejecting the payload.
+ */
+esp_err_t ring_link_lowlevel_transmit_payload_wait(ring_link_payload_t *p, TickType_t ticks);
+
+/**
+ * @brief Sends a received payload on to the next board, one hop less to live.
+ *
+ * A reassembled message is not sent: its fragments were forwarded as they
+ * arrived.
+ */
 esp_err_t ring_link_lowlevel_forward_payload(ring_link_payload_t *p);
 
+/**
+ * @brief Releases a received payload: an RX buffer, a heap copy unpacked from
+ * an AGGREGATE frame or a message reassembled from fragments.
+ */
 esp_err_t ring_link_lowlevel_free_rx_buffer(void *p);
 
 #ifdef __cplusplus
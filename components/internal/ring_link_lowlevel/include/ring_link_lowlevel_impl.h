@@ -5,9 +5,42 @@
 #include "spi.h"
 
 #define RING_LINK_LOWLEVEL_BUFFER_SIZE          SPI_BUFFER_SIZE
+#define RING_LINK_LOWLEVEL_RX_BUFFERS           SPI_RX_BUFFERS
+#define RING_LINK_LOWLEVEL_TX_BUFFERS           SPI_TX_BUFFERS
 #define RING_LINK_LOWLEVEL_IMPL_INIT            spi_init
 #define RING_LINK_LOWLEVEL_IMPL_TRANSMIT        spi_transmit
 #define RING_LINK_LOWLEVEL_IMPL_FREE_RX_BUFFER  spi_free_rx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_IS_RX_BUFFER    spi_is_rx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_FREE_RX_COUNT   spi_get_free_rx_count
+#define RING_LINK_LOWLEVEL_IMPL_ALLOC_TX_BUFFER  spi_alloc_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_FREE_TX_BUFFER  spi_free_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_IS_TX_BUFFER    spi_is_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_RX_ERROR_COUNT  spi_get_rx_error_count
+#define RING_LINK_LOWLEVEL_IMPL_RX_DROP_COUNT   spi_get_rx_drop_count
+#define RING_LINK_LOWLEVEL_IMPL_SET_RX_TASK     spi_set_rx_task
+#define RING_LINK_LOWLEVEL_IMPL_GET_RATES       spi_get_rates
+#define RING_LINK_LOWLEVEL_IMPL_SET_RATE        spi_set_clock
+#endif
+
+#ifdef CONFIG_RING_LINK_LOWLEVEL_IMPL_SIM
+#include "sim_link.h"
+
+#define RING_LINK_LOWLEVEL_BUFFER_SIZE          SIM_LINK_BUFFER_SIZE
+#define RING_LINK_LOWLEVEL_RX_BUFFERS           SIM_LINK_RX_BUFFERS
+#define RING_LINK_LOWLEVEL_TX_BUFFERS           SIM_LINK_TX_BUFFERS
+#define RING_LINK_LOWLEVEL_IMPL_INIT            sim_link_init
+#define RING_LINK_LOWLEVEL_IMPL_TRANSMIT        sim_link_transmit
+#define RING_LINK_LOWLEVEL_IMPL_FREE_RX_BUFFER  sim_link_free_rx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_IS_RX_BUFFER    sim_link_is_rx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_FREE_RX_COUNT   sim_link_get_free_rx_count
+#define RING_LINK_LOWLEVEL_IMPL_ALLOC_TX_BUFFER  sim_link_alloc_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_FREE_TX_BUFFER  sim_link_free_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_IS_TX_BUFFER    sim_link_is_tx_buffer
+#define RING_LINK_LOWLEVEL_IMPL_RX_ERROR_COUNT  sim_link_get_rx_error_count
+#define RING_LINK_LOWLEVEL_IMPL_RX_DROP_COUNT   sim_link_get_rx_drop_count
+#define RING_LINK_LOWLEVEL_IMPL_SET_RX_TASK     sim_link_set_rx_task
+#define RING_LINK_LOWLEVEL_IMPL_GET_RATES       sim_link_get_rates
+#define RING_LINK_LOWLEVEL_IMPL_SET_RATE        sim_link_set_clock
 #endif
 
 #endif
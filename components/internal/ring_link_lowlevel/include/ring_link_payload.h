@@ -3,6 +3,7 @@
 // C libraries
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include "config.h"
 #include "ring_link_lowlevel_impl.h"
@@ -11,10 +12,51 @@
 extern "C" {
 #endif
 
-#define RING_LINK_PAYLOAD_CRC_LEN  (sizeof(ring_link_payload_t) - sizeof(((ring_link_payload_t *)0)->crc32))
-#define RING_LINK_NETIF_MTU (SPI_BUFFER_SIZE - 12)
+#define RING_LINK_PAYLOAD_DATA_MAX (RING_LINK_LOWLEVEL_BUFFER_SIZE - 76)  // header (20) + CRC32 + credit records (52)
+#define RING_LINK_NETIF_MTU CONFIG_RING_LINK_MTU  // larger messages are fragmented, see ring_link_fragment.h
 #define RING_LINK_PAYLOAD_TTL 4
 
+#define RING_LINK_CREDIT_MAX_NODES (CONFIG_ID_CENTER + 1)  // one record per board, CONFIG_ID_NORTH..CONFIG_ID_CENTER
+#define RING_LINK_PAYLOAD_CREDITS_SPACE 52  // room for every credit record, word aligned
+
+#define RING_LINK_PAYLOAD_FLAG_CTL_SEQ     0x01  // ctl_seq is valid, the frame expects an ACK
+#define RING_LINK_PAYLOAD_FLAG_FRAGMENT    0x02  // buffer starts with a ring_link_fragment_header_t
+#define RING_LINK_PAYLOAD_FLAG_REASSEMBLED 0x04  // message rebuilt from fragments, never on the wire
+#define RING_LINK_PAYLOAD_FLAG_HC_FULL     0x08  // IP packet that starts a compression context, see ring_link_netif_hc.h
+#define RING_LINK_PAYLOAD_FLAG_HC          0x10  // IP packet with a compressed header
+#define RING_LINK_PAYLOAD_FLAG_DATA_CRC    0x20  // the data CRC32 is the originator's, kept on forward; never on the wire
+#define RING_LINK_PAYLOAD_FLAG_ACK_REQ     0x40  // unicast internal message, the destination answers with an ACK
+#define RING_LINK_PAYLOAD_FLAG_ACK         0x80  // empty internal frame acknowledging the message with the same id
+
+#define RING_LINK_PAYLOAD_HEADER_LEN  offsetof(ring_link_payload_t, buffer)
+#define RING_LINK_PAYLOAD_CRC_SIZE    sizeof(uint32_t)
+
+/**
+ * @brief Offset in the buffer of the credit records of a payload carrying
+ * `data_len` bytes: right after the CRC32, on the next whole word.
+ */
+#define RING_LINK_PAYLOAD_CREDITS_OFFSET(data_len) \
+    (((data_len) + RING_LINK_PAYLOAD_CRC_SIZE + 3) & ~(size_t)3)
+
+/**
+ * @brief Number of bytes clocked on the wire for a payload carrying `data_len`
+ * bytes and `credit_count` credit records.
+ *
+ * Only the header, the used part of the buffer, the CRC32 that follows it and
+ * the credit records are sent. The result is a whole number of words because
+ * the ESP32 SPI slave DMA may lose the trailing bytes of transfers that are not.
+ */
+#define RING_LINK_PAYLOAD_WIRE_LEN(data_len, credit_count) \
+    (RING_LINK_PAYLOAD_HEADER_LEN + RING_LINK_PAYLOAD_CREDITS_OFFSET(data_len) \
+     + (size_t)(credit_count) * sizeof(ring_link_credit_record_t))
+
+/**
+ * @brief Bytes to copy to duplicate a payload: the data CRC32 is only worth
+ * copying when it is kept (RING_LINK_PAYLOAD_FLAG_DATA_CRC).
+ */
+#define RING_LINK_PAYLOAD_COPY_LEN(p) \
+    (RING_LINK_PAYLOAD_HEADER_LEN + (p)->len + (((p)->flags & RING_LINK_PAYLOAD_FLAG_DATA_CRC) ? RING_LINK_PAYLOAD_CRC_SIZE : 0))
+
 /**
  * @brief Types of payloads in the ring link communication.
  *
@@ -32,22 +74,77 @@ extern "C" {
  */
 typedef enum __attribute__((__packed__)) {
     RING_LINK_PAYLOAD_TYPE_INTERNAL = 0x11,
+    RING_LINK_PAYLOAD_TYPE_LINK_STATE = 0x13,
+    RING_LINK_PAYLOAD_TYPE_AGGREGATE = 0x14,
+    RING_LINK_PAYLOAD_TYPE_TRAINING = 0x15,
     RING_LINK_PAYLOAD_TYPE_ESP_NETIF = 0x80,
 } ring_link_payload_buffer_type_t;
 
-typedef uint8_t ring_link_payload_id_t;
+typedef uint16_t ring_link_payload_id_t;  // wide enough to tell apart every message in flight
+
+/**
+ * @brief Receive-side state a board advertises to the rest of the ring.
+ *
+ * Every frame carries the sender's own record and the records of other
+ * boards that changed since the last frame it sent, so the record of a board
+ * eventually reaches its upstream neighbour (the board whose SPI master
+ * feeds it), which uses it as its transmit credit.
+ */
+typedef struct {
+    config_id_t owner;     // board the record describes
+    config_id_t upstream;  // board feeding this one, CONFIG_ID_NONE if unknown
+    uint8_t gen;           // bumped by the owner each time the record changes
+    uint8_t free_rx;       // free RX buffers when the record was taken
+    uint8_t rx_seq;        // last hop_seq received from upstream at that time
+    uint8_t ctl_ack;       // every ctl_seq from upstream up to this one was received
+    uint8_t ctl_sack;      // bit i: ctl_ack + 1 + i was received too
+    uint8_t hc_refresh;    // bit i: board i is asked to resend its full IP headers, see ring_link_netif_hc.h
+    uint16_t rx_errors;    // damaged frames received from upstream, wraps around
+} ring_link_credit_record_t;
 
 typedef struct {
     ring_link_payload_id_t id;
     ring_link_payload_buffer_type_t buffer_type;
-    uint16_t len;
     uint8_t ttl;
+    uint16_t len;
     config_id_t src_id;
     config_id_t dst_id;
-    char buffer[RING_LINK_NETIF_MTU];
-    uint32_t crc32;
+    config_id_t hop_src;   // board that put the frame on this link
+    uint8_t hop_seq;       // per-link frame counter of hop_src
+    uint8_t ctl_seq;       // per-link sequence of internal frames, see flags
+    uint8_t flags;         // RING_LINK_PAYLOAD_FLAG_*
+    uint8_t credit_count;  // credit records after the data, see ring_link_payload_credits
+    uint8_t reserved[3];
+    uint32_t hop_crc;      // CRC32 of the rest of the header and of the credit records, stamped on every hop
+    char buffer[RING_LINK_PAYLOAD_DATA_MAX + RING_LINK_PAYLOAD_CRC_SIZE + RING_LINK_PAYLOAD_CREDITS_SPACE];  // data, its CRC32 and the credit records; word aligned, handed to lwIP as is
 } ring_link_payload_t;
 
+/**
+ * @brief Credit records of a payload, stamped on every hop after its data.
+ */
+static inline ring_link_credit_record_t *ring_link_payload_credits(const ring_link_payload_t *p)
+{
+    return (ring_link_credit_record_t *)(p->buffer + RING_LINK_PAYLOAD_CREDITS_OFFSET(p->len));
+}
+
+/**
+ * @brief Classes of received frames; the lowlevel driver keeps one RX queue per class.
+ */
+typedef enum {
+    RING_LINK_RX_CLASS_CONTROL = 0,  // every type but ESP_NETIF, dispatched first
+    RING_LINK_RX_CLASS_DATA,
+    RING_LINK_RX_CLASSES,
+} ring_link_rx_class_t;
+
+/**
+ * @brief Class of a received frame. Inline so the driver can call it from its
+ * completion ISR, before the frame is checked.
+ */
+static inline __attribute__((always_inline)) ring_link_rx_class_t ring_link_payload_rx_class(const ring_link_payload_t *p)
+{
+    return p->buffer_type == RING_LINK_PAYLOAD_TYPE_ESP_NETIF ? RING_LINK_RX_CLASS_DATA : RING_LINK_RX_CLASS_CONTROL;
+}
+
 bool ring_link_payload_is_for_device(ring_link_payload_t *p);
 
 bool ring_link_payload_is_from_device(ring_link_payload_t *p);
@@ -58,8 +155,48 @@ bool ring_link_payload_is_internal(ring_link_payload_t *p);
 
 bool ring_link_payload_is_esp_netif(ring_link_payload_t *p);
 
+bool ring_link_payload_is_link_state(ring_link_payload_t *p);
+
+/**
+ * @brief Several small payloads packed for one hop, see ring_link_aggregate.h.
+ */
+bool ring_link_payload_is_aggregate(ring_link_payload_t *p);
+
+/**
+ * @brief Test pattern sent while training the link clock, consumed by the next board.
+ */
+bool ring_link_payload_is_training(ring_link_payload_t *p);
+
+/**
+ * @brief Ring control-plane payloads: internal messages and link state.
+ */
+bool ring_link_payload_is_control(ring_link_payload_t *p);
+
+/**
+ * @brief CRC32 of the `len` data bytes, set once by the board that creates the frame.
+ */
 uint32_t ring_link_compute_crc32(const ring_link_payload_t *p);
 
+/**
+ * @brief Stamps the checksums of a frame about to go on the link.
+ *
+ * The data CRC32, stored right after the last data byte, is computed unless
+ * the frame is forwarded with its originator's (RING_LINK_PAYLOAD_FLAG_DATA_CRC).
+ * hop_crc, which covers the header, is computed every time.
+ */
+void ring_link_payload_seal(ring_link_payload_t *p);
+
+/**
+ * @brief Checks the length fields and hop_crc. Enough to credit, acknowledge
+ * and forward the frame.
+ */
+bool ring_link_payload_header_is_valid(const ring_link_payload_t *p);
+
+/**
+ * @brief Checks the CRC32 that follows the data.
+ */
+bool ring_link_payload_data_is_valid(const ring_link_payload_t *p);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_RATE_UP_WINDOWS     10   // clean windows before probing the next rate
+#define RING_LINK_RATE_UP_WINDOWS_MAX 640  // cap of the back-off after failed probes
+#define RING_LINK_RATE_SILENT_WINDOWS 10   // windows without any report before stepping down anyway
+
+/**
+ * @brief Clock selection of one ring link.
+ *
+ * Pure logic, it only sees frame and error counts per measurement window, so
+ * it can be driven by the real link or by a simulated lossy transport.
+ *
+ * Training starts at the fastest rate of the ladder and steps down until a
+ * window has an acceptable frame error rate. At run time a bad window steps
+ * down one rate; after enough clean windows the next rate is probed, and each
+ * failed probe doubles the number of clean windows needed for the next one.
+ *
+ * The error counts come back from the receiver around the ring, so a link
+ * too fast to carry them gives no sample at all. RING_LINK_RATE_SILENT_WINDOWS
+ * windows in a row without one step the rate down like a bad window.
+ */
+typedef struct {
+    const int *ladder;       // clock rates in Hz, slowest first
+    size_t ladder_len;
+    size_t index;            // current rate
+    bool training;
+    bool probing;            // the current rate was just probed upwards
+    uint32_t max_fer_permille;
+    uint16_t clean_windows;  // consecutive windows without errors at this rate
+    uint16_t up_after;       // clean windows needed before the next probe
+    uint16_t silent_windows; // consecutive windows without a report
+} ring_link_rate_t;
+
+void ring_link_rate_init(ring_link_rate_t *r, const int *ladder, size_t ladder_len, uint32_t max_fer_permille);
+
+/**
+ * @brief Feeds the counts of one measurement window.
+ *
+ * @param frames Frames sent on the link during the window.
+ * @param errors Frames the receiver got damaged or never got.
+ * @return true if the rate changed; read it with ring_link_rate_hz.
+ */
+bool ring_link_rate_update(ring_link_rate_t *r, uint32_t frames, uint32_t errors);
+
+/**
+ * @brief Counts a measurement window without any report from the receiver.
+ *
+ * @return true if the rate changed; read it with ring_link_rate_hz.
+ */
+bool ring_link_rate_silent(ring_link_rate_t *r);
+
+int ring_link_rate_hz(const ring_link_rate_t *r);
+
+bool ring_link_rate_is_training(const ring_link_rate_t *r);
+
+#ifdef __cplusplus
+}
+#endif
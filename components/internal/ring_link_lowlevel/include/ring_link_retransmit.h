@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#include "ring_link_payload.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_RETRANSMIT_WINDOW    8  // unacked internal frames per link, one ctl_sack bit each
+#define RING_LINK_RETRANSMIT_MAX_TRIES 4  // sends of an internal frame before giving up on it
+
+/**
+ * @brief Allocates the copies of the retransmit window and derives the
+ * retransmission timeout.
+ *
+ * The timeout is CONFIG_RING_LINK_RETRANSMIT_RTO_MS plus the time an
+ * acknowledgement needs to come round the ring: one full frame at the slowest
+ * link clock and one LINK_STATE gap per board.
+ */
+esp_err_t ring_link_retransmit_init(void);
+
+/**
+ * @brief Tells whether the TX scheduler may put this control frame on the link now.
+ *
+ * Internal frames wait while the retransmit window is full; link state
+ * frames never do.
+ */
+bool ring_link_retransmit_can_send(ring_link_payload_t *p);
+
+/**
+ * @brief Numbers a control frame about to be sent for the first time.
+ *
+ * Internal frames get the next ctl_seq of the link and a copy is kept until
+ * the downstream neighbour acknowledges it. If the neighbour's credit record
+ * is unknown, acknowledgements cannot come back and the frame is sent once.
+ * Only called by the TX scheduler task.
+ */
+void ring_link_retransmit_track(ring_link_payload_t *p);
+
+/**
+ * @brief Returns a TX payload with the next internal frame due for retransmission.
+ *
+ * @param[out] wait Ticks until the next retransmission timeout, portMAX_DELAY if none.
+ * @return NULL when nothing is due yet. Only called by the TX scheduler task.
+ */
+ring_link_payload_t *ring_link_retransmit_next(TickType_t *wait);
+
+/**
+ * @brief Takes the acknowledgement carried by the downstream neighbour's record.
+ */
+void ring_link_retransmit_ack(uint8_t ctl_ack, uint8_t ctl_sack);
+
+/**
+ * @brief Records an internal frame received from upstream.
+ *
+ * @return false if the frame is a duplicate and must be dropped.
+ */
+bool ring_link_retransmit_receive(ring_link_payload_t *p);
+
+/**
+ * @brief Acknowledgement to advertise upstream in this board's credit record.
+ */
+void ring_link_retransmit_get_ack(uint8_t *ctl_ack, uint8_t *ctl_sack);
+
+#ifdef __cplusplus
+}
+#endif
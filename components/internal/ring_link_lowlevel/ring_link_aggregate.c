@@ -0,0 +1,152 @@
+#include "ring_link_aggregate.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+static const char* TAG = "==> ring_link_aggregate";
+
+#define SUB_HEADER_LEN sizeof(ring_link_aggregate_header_t)
+#define SUB_LEN(data_len) ((SUB_HEADER_LEN + (data_len) + 3) & ~(size_t)3)
+
+#ifdef CONFIG_RING_LINK_AGGREGATE
+// Buffer de un sub-payload desempaquetado: cabecera y el mayor dato empaquetable
+#define SUB_PAYLOAD_SIZE \
+    ((RING_LINK_PAYLOAD_HEADER_LEN + CONFIG_RING_LINK_AGGREGATE_MAX_LEN + RING_LINK_PAYLOAD_CRC_SIZE + 3) & ~(size_t)3)
+
+static uint8_t *s_sub_pool_mem = NULL;
+static QueueHandle_t s_sub_pool = NULL;  // free sub-payload buffers
+#endif
+
+esp_err_t ring_link_aggregate_init(void)
+{
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    s_sub_pool_mem = malloc(RING_LINK_AGGREGATE_SUB_POOL * SUB_PAYLOAD_SIZE);
+    s_sub_pool = xQueueCreate(RING_LINK_AGGREGATE_SUB_POOL, sizeof(ring_link_payload_t *));
+    if (s_sub_pool_mem == NULL || s_sub_pool == NULL) {
+        ESP_LOGE(TAG, "Failed to create the sub-payload pool");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < RING_LINK_AGGREGATE_SUB_POOL; i++) {
+        ring_link_payload_t *p = (ring_link_payload_t *)(s_sub_pool_mem + i * SUB_PAYLOAD_SIZE);
+        xQueueSend(s_sub_pool, &p, 0);
+    }
+#endif
+    return ESP_OK;
+}
+
+bool ring_link_aggregate_is_sub_payload(const void *p)
+{
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    const uint8_t *b = p;
+    return s_sub_pool_mem != NULL && b >= s_sub_pool_mem
+        && b < s_sub_pool_mem + RING_LINK_AGGREGATE_SUB_POOL * SUB_PAYLOAD_SIZE;
+#else
+    return false;
+#endif
+}
+
+void ring_link_aggregate_free_sub_payload(ring_link_payload_t *p)
+{
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    xQueueSend(s_sub_pool, &p, 0);
+#endif
+}
+
+bool ring_link_aggregate_is_candidate(ring_link_payload_t *p)
+{
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    return p->len <= CONFIG_RING_LINK_AGGREGATE_MAX_LEN
+        && (ring_link_payload_is_internal(p) || ring_link_payload_is_esp_netif(p));
+#else
+    return false;
+#endif
+}
+
+void ring_link_aggregate_start(ring_link_payload_t *agg)
+{
+    agg->id = 0;
+    agg->buffer_type = RING_LINK_PAYLOAD_TYPE_AGGREGATE;
+    agg->len = 0;
+    agg->ttl = 0;
+    agg->src_id = config_get_id();
+    agg->dst_id = CONFIG_ID_ANY;
+    agg->ctl_seq = 0;
+    agg->flags = 0;
+}
+
+bool ring_link_aggregate_fits(const ring_link_payload_t *agg, const ring_link_payload_t *p)
+{
+    return agg->len + SUB_HEADER_LEN + p->len <= RING_LINK_PAYLOAD_DATA_MAX;
+}
+
+bool ring_link_aggregate_append(ring_link_payload_t *agg, const ring_link_payload_t *p)
+{
+    size_t offset = agg->len;
+    if (!ring_link_aggregate_fits(agg, p)) {
+        return false;
+    }
+
+    ring_link_aggregate_header_t h = {
+        .id = p->id,
+        .buffer_type = p->buffer_type,
+        .len = p->len,
+        .ttl = p->ttl,
+        .src_id = p->src_id,
+        .dst_id = p->dst_id,
+        .ctl_seq = p->ctl_seq,
+        .flags = p->flags & ~RING_LINK_PAYLOAD_FLAG_DATA_CRC,  // the sub-payload travels without its CRC
+    };
+    memcpy(agg->buffer + offset, &h, SUB_HEADER_LEN);
+    memcpy(agg->buffer + offset + SUB_HEADER_LEN, p->buffer, p->len);
+
+    // El relleno del ultimo sub-payload no viaja
+    size_t end = offset + SUB_LEN(p->len);
+    agg->len = end < RING_LINK_PAYLOAD_DATA_MAX ? end : RING_LINK_PAYLOAD_DATA_MAX;
+    return true;
+}
+
+ring_link_payload_t *ring_link_aggregate_unpack(const ring_link_payload_t *agg, size_t *offset)
+{
+    ring_link_aggregate_header_t h;
+
+    if (*offset + SUB_HEADER_LEN > agg->len) {
+        return NULL;
+    }
+    memcpy(&h, agg->buffer + *offset, SUB_HEADER_LEN);
+    if (*offset + SUB_HEADER_LEN + h.len > agg->len) {
+        ESP_LOGW(TAG, "Malformed aggregate (sub-payload len=%u at %u), dropping the rest.",
+                 h.len, (unsigned)*offset);
+        return NULL;
+    }
+
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    ring_link_payload_t *p;
+    if (h.len > CONFIG_RING_LINK_AGGREGATE_MAX_LEN) {
+        ESP_LOGW(TAG, "Sub-payload larger than CONFIG_RING_LINK_AGGREGATE_MAX_LEN (%u), dropping the rest.", h.len);
+        return NULL;
+    }
+    if (xQueueReceive(s_sub_pool, &p, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "No free sub-payload buffer, dropping the rest of the aggregate.");
+        return NULL;
+    }
+#else
+    ESP_LOGW(TAG, "Aggregates disabled, dropping one.");
+    return NULL;
+#endif
+    memcpy(p, agg, RING_LINK_PAYLOAD_HEADER_LEN);
+    p->id = h.id;
+    p->buffer_type = h.buffer_type;
+    p->len = h.len;
+    p->ttl = h.ttl;
+    p->src_id = h.src_id;
+    p->dst_id = h.dst_id;
+    p->ctl_seq = h.ctl_seq;
+    p->flags = h.flags;
+    memcpy(p->buffer, agg->buffer + *offset + SUB_HEADER_LEN, h.len);
+
+    *offset += SUB_LEN(h.len);
+    return p;
+}
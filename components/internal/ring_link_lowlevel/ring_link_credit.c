@@ -0,0 +1,338 @@
+#include "ring_link_credit.h"
+
+#include <limits.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "task_config.h"
+
+#include "ring_link_lowlevel.h"
+#include "ring_link_retransmit.h"
+
+static const char* TAG = "==> ring_link_credit";
+
+typedef struct {
+    ring_link_credit_record_t record;
+    TickType_t updated;  // tick of the last accepted update
+    bool known;
+    bool sent;           // this version already went downstream
+} credit_entry_t;
+
+static portMUX_TYPE s_credit_lock = portMUX_INITIALIZER_UNLOCKED;
+static credit_entry_t s_table[RING_LINK_CREDIT_MAX_NODES];
+static ring_link_credit_record_t s_own = { .upstream = CONFIG_ID_NONE };  // own record being built
+static uint8_t s_tx_seq = 0;           // hop_seq of the last frame sent downstream
+static TickType_t s_last_tx = 0;      // tick of the last frame sent downstream
+static bool s_dirty = false;           // there is news not yet sent downstream
+static uint16_t s_rx_errors = 0;       // frames from upstream dropped for a bad CRC
+
+static TaskHandle_t s_tx_task = NULL;          // notified when the downstream record changes
+static TaskHandle_t s_credit_task = NULL;
+
+static bool is_node_id(uint8_t id)
+{
+    return id < RING_LINK_CREDIT_MAX_NODES;
+}
+
+static bool is_stale(const credit_entry_t *e, TickType_t now)
+{
+    return (now - e->updated) > pdMS_TO_TICKS(CONFIG_RING_LINK_CREDIT_STALE_MS);
+}
+
+// Must be called with s_credit_lock held
+static int credits_available(TickType_t now)
+{
+    config_id_t me = config_get_id();
+
+    for (int i = 0; i < RING_LINK_CREDIT_MAX_NODES; i++) {
+        const credit_entry_t *e = &s_table[i];
+        if (!e->known || e->record.upstream != me || is_stale(e, now)) {
+            continue;
+        }
+        uint8_t in_flight = (uint8_t)(s_tx_seq - e->record.rx_seq);
+        if (in_flight > RING_LINK_CREDIT_MAX_IN_FLIGHT) {
+            return INT_MAX;
+        }
+        return (int)e->record.free_rx - in_flight;
+    }
+    return INT_MAX;
+}
+
+void ring_link_credit_stamp(ring_link_payload_t *p)
+{
+    config_id_t me = config_get_id();
+    uint8_t free_rx = (uint8_t)RING_LINK_LOWLEVEL_IMPL_FREE_RX_COUNT();
+    TickType_t now = xTaskGetTickCount();
+    uint8_t ctl_ack, ctl_sack;
+
+    ring_link_retransmit_get_ack(&ctl_ack, &ctl_sack);
+    portENTER_CRITICAL(&s_credit_lock);
+    if (is_node_id(me)) {
+        credit_entry_t *own = &s_table[me];
+        s_own.owner = me;
+        s_own.free_rx = free_rx;
+        s_own.ctl_ack = ctl_ack;
+        s_own.ctl_sack = ctl_sack;
+        s_own.rx_errors = (uint16_t)(s_rx_errors + RING_LINK_LOWLEVEL_IMPL_RX_ERROR_COUNT());
+        s_own.gen = own->record.gen;
+        if (!own->known || memcmp(&s_own, &own->record, sizeof(s_own)) != 0
+            || (now - own->updated) >= pdMS_TO_TICKS(RING_LINK_CREDIT_KEEPALIVE_MS)) {
+            s_own.gen++;
+            own->record = s_own;
+            own->updated = now;
+            own->known = true;
+        }
+    }
+
+    p->hop_src = me;
+    p->hop_seq = ++s_tx_seq;
+
+    // Viajan el registro propio y los que cambiaron desde el ultimo frame; el
+    // dueño renueva el suyo cada keepalive, asi que un frame perdido no los congela
+    ring_link_credit_record_t *records = ring_link_payload_credits(p);
+    uint8_t count = 0;
+    for (int i = 0; i < RING_LINK_CREDIT_MAX_NODES; i++) {
+        credit_entry_t *e = &s_table[i];
+        if (!e->known || is_stale(e, now) || (i != me && e->sent)) {
+            continue;
+        }
+        records[count++] = e->record;
+        e->sent = true;
+    }
+    p->credit_count = count;
+    s_dirty = false;
+    s_last_tx = now;
+    portEXIT_CRITICAL(&s_credit_lock);
+}
+
+void ring_link_credit_receive(const ring_link_payload_t *p)
+{
+    config_id_t me = config_get_id();
+    TickType_t now = xTaskGetTickCount();
+    bool news = false;
+    bool downstream_changed = false;
+    uint8_t ctl_ack = 0, ctl_sack = 0;
+
+    portENTER_CRITICAL(&s_credit_lock);
+    s_own.upstream = p->hop_src;
+    s_own.rx_seq = p->hop_seq;
+    const ring_link_credit_record_t *records = ring_link_payload_credits(p);
+    for (int i = 0; i < p->credit_count; i++) {
+        const ring_link_credit_record_t *r = &records[i];
+        if (!is_node_id(r->owner) || r->owner == me || !is_node_id(r->upstream)) {
+            continue;
+        }
+        credit_entry_t *e = &s_table[r->owner];
+        // Una vez vencido, solo se acepta un gen distinto (el dueño se reinicio)
+        bool newer = !e->known
+            || (is_stale(e, now) ? r->gen != e->record.gen : (int8_t)(r->gen - e->record.gen) > 0);
+        if (!newer) {
+            continue;
+        }
+        e->record = *r;
+        e->updated = now;
+        e->known = true;
+        e->sent = false;
+        news = true;
+        if (r->upstream == me) {
+            downstream_changed = true;
+            ctl_ack = r->ctl_ack;
+            ctl_sack = r->ctl_sack;
+        }
+    }
+    s_dirty |= news;
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    if (downstream_changed) {
+        ring_link_retransmit_ack(ctl_ack, ctl_sack);
+        if (s_tx_task != NULL) {
+            xTaskNotifyGive(s_tx_task);
+        }
+    }
+    if (news && s_credit_task != NULL) {
+        xTaskNotifyGive(s_credit_task);
+    }
+}
+
+void ring_link_credit_changed(void)
+{
+    portENTER_CRITICAL(&s_credit_lock);
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    if (s_credit_task != NULL) {
+        xTaskNotifyGive(s_credit_task);
+    }
+}
+
+bool ring_link_credit_available(void)
+{
+#ifdef CONFIG_RING_LINK_CREDIT
+    portENTER_CRITICAL(&s_credit_lock);
+    int available = credits_available(xTaskGetTickCount());
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    return available > RING_LINK_CREDIT_RESERVE;
+#else
+    return true;
+#endif
+}
+
+void ring_link_credit_rx_error(void)
+{
+    portENTER_CRITICAL(&s_credit_lock);
+    s_rx_errors++;
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    if (s_credit_task != NULL) {
+        xTaskNotifyGive(s_credit_task);
+    }
+}
+
+bool ring_link_credit_downstream_errors(uint16_t *rx_errors)
+{
+    config_id_t me = config_get_id();
+    TickType_t now = xTaskGetTickCount();
+    bool known = false;
+
+    portENTER_CRITICAL(&s_credit_lock);
+    for (int i = 0; i < RING_LINK_CREDIT_MAX_NODES; i++) {
+        const credit_entry_t *e = &s_table[i];
+        if (e->known && e->record.upstream == me && !is_stale(e, now)) {
+            *rx_errors = e->record.rx_errors;
+            known = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    return known;
+}
+
+bool ring_link_credit_downstream_known(void)
+{
+    config_id_t me = config_get_id();
+    TickType_t now = xTaskGetTickCount();
+    bool known = false;
+
+    portENTER_CRITICAL(&s_credit_lock);
+    for (int i = 0; i < RING_LINK_CREDIT_MAX_NODES; i++) {
+        const credit_entry_t *e = &s_table[i];
+        if (e->known && e->record.upstream == me && !is_stale(e, now)) {
+            known = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    return known;
+}
+
+void ring_link_credit_set_refresh(config_id_t src, bool requested)
+{
+    if (!is_node_id(src)) {
+        return;
+    }
+    uint8_t bit = 1u << src;
+    bool changed;
+
+    portENTER_CRITICAL(&s_credit_lock);
+    uint8_t before = s_own.hc_refresh;
+    s_own.hc_refresh = requested ? (before | bit) : (before & ~bit);
+    changed = s_own.hc_refresh != before;
+    s_dirty |= changed;
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    if (changed && s_credit_task != NULL) {
+        xTaskNotifyGive(s_credit_task);
+    }
+}
+
+bool ring_link_credit_refresh_requested(config_id_t board)
+{
+    config_id_t me = config_get_id();
+    TickType_t now = xTaskGetTickCount();
+    bool requested = false;
+
+    if (!is_node_id(me)) {
+        return false;
+    }
+    portENTER_CRITICAL(&s_credit_lock);
+    for (int i = 0; i < RING_LINK_CREDIT_MAX_NODES; i++) {
+        const credit_entry_t *e = &s_table[i];
+        bool target = board == CONFIG_ID_ANY ? e->record.upstream == me : i == board;
+        if (target && i != me && e->known && !is_stale(e, now)) {
+            requested = (e->record.hc_refresh & (1u << me)) != 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_credit_lock);
+
+    return requested;
+}
+
+void ring_link_credit_set_tx_task(TaskHandle_t task)
+{
+    s_tx_task = task;
+}
+
+// Envia un frame de estado cuando hay novedades que ningun otro frame llevo
+// aguas abajo, o cuando el enlace estuvo ocioso durante el keepalive. Entre
+// dos frames pasa al menos el intervalo minimo: cada buffer de RX liberado
+// avisa, y sin limite cada aviso seria una ola de frames por todo el anillo.
+static void ring_link_credit_task(void *pvParameters)
+{
+    static ring_link_payload_t link_state;
+    const TickType_t keepalive = pdMS_TO_TICKS(RING_LINK_CREDIT_KEEPALIVE_MS);
+    const TickType_t min_gap = RING_LINK_CREDIT_STATE_MIN_TICKS;
+    TickType_t wait = keepalive;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        wait = keepalive;
+
+        portENTER_CRITICAL(&s_credit_lock);
+        TickType_t since = xTaskGetTickCount() - s_last_tx;
+        bool send = s_dirty || since >= keepalive;
+        portEXIT_CRITICAL(&s_credit_lock);
+        if (!send) {
+            continue;
+        }
+        if (since < min_gap) {
+            wait = min_gap - since;
+            continue;
+        }
+
+        link_state.id = 0;
+        link_state.buffer_type = RING_LINK_PAYLOAD_TYPE_LINK_STATE;
+        link_state.len = 0;
+        link_state.ttl = 0;
+        link_state.src_id = config_get_id();
+        link_state.dst_id = CONFIG_ID_ANY;
+        if (ring_link_lowlevel_transmit_payload(&link_state) != ESP_OK) {
+            ESP_LOGD(TAG, "Could not send link state");
+        }
+    }
+}
+
+esp_err_t ring_link_credit_init(void)
+{
+#ifdef CONFIG_RING_LINK_CREDIT
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        ring_link_credit_task,
+        "ring_link_credit",
+        TASK_RING_LINK_CREDIT_STACK,
+        NULL,
+        TASK_RING_LINK_CREDIT_PRIORITY,
+        &s_credit_task,
+        TASK_RING_LINK_CREDIT_CORE
+    );
+    if (ret != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to create credit task");
+        return ESP_FAIL;
+    }
+#endif
+
+    return ESP_OK;
+}
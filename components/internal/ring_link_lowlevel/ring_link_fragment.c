@@ -0,0 +1,222 @@
+#include "ring_link_fragment.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/task.h"
+
+#include "ring_link_lowlevel.h"
+
+static const char* TAG = "==> ring_link_fragment";
+
+#define FRAG_HEADER_LEN sizeof(ring_link_fragment_header_t)
+
+_Static_assert(RING_LINK_NETIF_MTU <= RING_LINK_FRAGMENT_MAX * RING_LINK_FRAGMENT_DATA_MAX,
+               "CONFIG_RING_LINK_MTU needs more fragments than a reassembly slot tracks");
+
+typedef struct {
+    ring_link_payload_t *msg;  // message being rebuilt, NULL if the slot is free
+    uint16_t msg_id;
+    uint32_t missing;          // bit i: fragment i has not arrived yet
+    TickType_t start;          // tick of the first fragment received
+} fragment_slot_t;
+
+static portMUX_TYPE s_msg_id_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_msg_id = 0;
+
+// Lado receptor, solo lo toca la tarea de despacho
+static fragment_slot_t s_slots[RING_LINK_FRAGMENT_SLOTS];
+
+static uint16_t next_msg_id(void)
+{
+    portENTER_CRITICAL(&s_msg_id_lock);
+    uint16_t id = s_msg_id++;
+    portEXIT_CRITICAL(&s_msg_id_lock);
+    return id;
+}
+
+// Espera un buffer del pool de TX y lugar en el scheduler, hasta `wait` en total
+static esp_err_t send_fragment(ring_link_payload_buffer_type_t buffer_type, ring_link_payload_id_t id, config_id_t dst_id,
+                               uint8_t flags, const ring_link_fragment_header_t *h, size_t chunk, TickType_t wait,
+                               ring_link_fragment_gather_t gather, void *ctx)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    ring_link_payload_t *p = ring_link_lowlevel_alloc_tx_payload_wait(wait);
+    if (p == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->id = id;
+    p->buffer_type = buffer_type;
+    p->len = FRAG_HEADER_LEN + chunk;
+    p->ttl = RING_LINK_PAYLOAD_TTL;
+    p->src_id = config_get_id();
+    p->dst_id = dst_id;
+    p->ctl_seq = 0;
+    p->flags = RING_LINK_PAYLOAD_FLAG_FRAGMENT | flags;
+    memcpy(p->buffer, h, FRAG_HEADER_LEN);
+    gather(ctx, h->offset, p->buffer + FRAG_HEADER_LEN, chunk);
+
+    TickType_t spent = xTaskGetTickCount() - start;
+    return ring_link_lowlevel_transmit_payload_wait(p, spent < wait ? wait - spent : 0);
+}
+
+static void gather_buffer(void *ctx, size_t offset, void *dst, size_t len)
+{
+    memcpy(dst, (const uint8_t *)ctx + offset, len);
+}
+
+esp_err_t ring_link_fragment_transmit(ring_link_payload_buffer_type_t buffer_type, ring_link_payload_id_t id,
+                                      config_id_t dst_id, uint8_t flags, const void *data, size_t len)
+{
+    return ring_link_fragment_transmit_gather(buffer_type, id, dst_id, flags, len, 0, gather_buffer, (void *)data);
+}
+
+esp_err_t ring_link_fragment_transmit_gather(ring_link_payload_buffer_type_t buffer_type, ring_link_payload_id_t id,
+                                             config_id_t dst_id, uint8_t flags, size_t len, TickType_t wait,
+                                             ring_link_fragment_gather_t gather, void *ctx)
+{
+    ring_link_fragment_header_t h = {
+        .msg_id = next_msg_id(),
+        .offset = 0,
+        .total_len = len,
+        .reserved = 0,
+    };
+
+    if (len > RING_LINK_NETIF_MTU) {
+        ESP_LOGE(TAG, "Message length (%u) exceeds maximum allowed size.", (unsigned)len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    while (h.offset < len) {
+        size_t chunk = len - h.offset;
+        if (chunk > RING_LINK_FRAGMENT_DATA_MAX) {
+            chunk = RING_LINK_FRAGMENT_DATA_MAX;
+        }
+        TickType_t chunk_wait = h.offset == 0 ? wait : pdMS_TO_TICKS(RING_LINK_FRAGMENT_TX_WAIT_MS);
+        esp_err_t rc = send_fragment(buffer_type, id, dst_id, flags, &h, chunk, chunk_wait, gather, ctx);
+        if (rc != ESP_OK) {
+            if (h.offset > 0) {
+                ESP_LOGW(TAG, "Message %u cut at %u of %u bytes (%s).",
+                         h.msg_id, h.offset, (unsigned)len, esp_err_to_name(rc));
+            }
+            return rc;
+        }
+        h.offset += chunk;
+    }
+    return ESP_OK;
+}
+
+static void release_slot(fragment_slot_t *slot)
+{
+    free(slot->msg);
+    slot->msg = NULL;
+}
+
+// Los mensajes incompletos se liberan al llegar el siguiente fragmento, asi
+// que a lo sumo quedan RING_LINK_FRAGMENT_SLOTS mensajes en memoria
+static void expire_slots(TickType_t now)
+{
+    for (int i = 0; i < RING_LINK_FRAGMENT_SLOTS; i++) {
+        fragment_slot_t *slot = &s_slots[i];
+        if (slot->msg != NULL && now - slot->start >= pdMS_TO_TICKS(CONFIG_RING_LINK_FRAGMENT_TIMEOUT_MS)) {
+            ESP_LOGD(TAG, "Message %u from %d timed out, dropping.", slot->msg_id, slot->msg->src_id);
+            release_slot(slot);
+        }
+    }
+}
+
+static fragment_slot_t *find_slot(const ring_link_payload_t *p, uint16_t msg_id)
+{
+    for (int i = 0; i < RING_LINK_FRAGMENT_SLOTS; i++) {
+        fragment_slot_t *slot = &s_slots[i];
+        if (slot->msg != NULL && slot->msg_id == msg_id
+            && slot->msg->src_id == p->src_id && slot->msg->buffer_type == p->buffer_type) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// Si no hay un slot libre se descarta el mensaje mas viejo
+static fragment_slot_t *new_slot(const ring_link_payload_t *p, const ring_link_fragment_header_t *h, TickType_t now)
+{
+    fragment_slot_t *slot = &s_slots[0];
+
+    for (int i = 0; i < RING_LINK_FRAGMENT_SLOTS; i++) {
+        if (s_slots[i].msg == NULL) {
+            slot = &s_slots[i];
+            break;
+        }
+        if (now - s_slots[i].start > now - slot->start) {
+            slot = &s_slots[i];
+        }
+    }
+    if (slot->msg != NULL) {
+        ESP_LOGD(TAG, "No free reassembly slot, dropping message %u from %d.", slot->msg_id, slot->msg->src_id);
+        release_slot(slot);
+    }
+
+    slot->msg = malloc(RING_LINK_PAYLOAD_HEADER_LEN + h->total_len);
+    if (slot->msg == NULL) {
+        ESP_LOGW(TAG, "No memory to reassemble a message of %u bytes.", h->total_len);
+        return NULL;
+    }
+    memcpy(slot->msg, p, RING_LINK_PAYLOAD_HEADER_LEN);
+    slot->msg->len = h->total_len;
+    slot->msg->ctl_seq = 0;
+    slot->msg->flags = RING_LINK_PAYLOAD_FLAG_REASSEMBLED | (p->flags & RING_LINK_PAYLOAD_FLAG_ACK_REQ);
+    slot->msg_id = h->msg_id;
+    size_t count = (h->total_len + RING_LINK_FRAGMENT_DATA_MAX - 1) / RING_LINK_FRAGMENT_DATA_MAX;
+    slot->missing = count >= 32 ? UINT32_MAX : (1u << count) - 1;
+    slot->start = now;
+    return slot;
+}
+
+ring_link_payload_t *ring_link_fragment_receive(ring_link_payload_t *p)
+{
+    ring_link_fragment_header_t h;
+    ring_link_payload_t *msg = NULL;
+    TickType_t now = xTaskGetTickCount();
+
+    expire_slots(now);
+
+    if (p->len < FRAG_HEADER_LEN) {
+        ESP_LOGW(TAG, "Fragment too short (len=%u), dropping.", p->len);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+    memcpy(&h, p->buffer, FRAG_HEADER_LEN);
+    size_t chunk = p->len - FRAG_HEADER_LEN;
+
+    // Todos los fragmentos menos el ultimo van llenos, el offset da su indice
+    if (h.total_len > RING_LINK_NETIF_MTU || h.offset % RING_LINK_FRAGMENT_DATA_MAX != 0
+        || h.offset + chunk > h.total_len
+        || (chunk != RING_LINK_FRAGMENT_DATA_MAX && h.offset + chunk != h.total_len)) {
+        ESP_LOGW(TAG, "Malformed fragment (offset=%u,len=%u,total=%u), dropping.",
+                 h.offset, (unsigned)chunk, h.total_len);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+
+    fragment_slot_t *slot = find_slot(p, h.msg_id);
+    if (slot == NULL) {
+        slot = new_slot(p, &h, now);
+    } else if (slot->msg->len != h.total_len) {
+        ESP_LOGW(TAG, "Fragment length mismatch in message %u, dropping it.", h.msg_id);
+        release_slot(slot);
+        slot = NULL;
+    }
+
+    uint32_t bit = 1u << (h.offset / RING_LINK_FRAGMENT_DATA_MAX);
+    if (slot != NULL && (slot->missing & bit)) {
+        memcpy(slot->msg->buffer + h.offset, p->buffer + FRAG_HEADER_LEN, chunk);
+        slot->missing &= ~bit;
+        if (slot->missing == 0) {
+            msg = slot->msg;
+            slot->msg = NULL;
+        }
+    }
+    ring_link_lowlevel_free_rx_buffer(p);
+    return msg;
+}
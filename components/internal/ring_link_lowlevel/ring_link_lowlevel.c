@@ -1,38 +1,354 @@
 #include "ring_link_lowlevel.h"
+#include <stdlib.h>
+#include <string.h>
+#include "task_config.h"
 
 static const char* TAG = "==> ring_link_lowlevel";
 
-static SemaphoreHandle_t s_tx_semaphore_handle = NULL;
+static QueueHandle_t s_tx_ctl_queue = NULL;   // Frames internos, prioridad estricta
+static QueueHandle_t s_tx_data_queue = NULL;  // Frames de esp_netif
+static TaskHandle_t s_tx_task = NULL;
 
-esp_err_t ring_link_lowlevel_init(QueueHandle_t **rx_queue) {
-    ESP_ERROR_CHECK(RING_LINK_LOWLEVEL_IMPL_INIT(rx_queue));
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+#define RING_LINK_RATE_TRAIN_FRAMES    16   // test frames sent per training window
+#define RING_LINK_RATE_TRAIN_WINDOW_MS 100
 
-    s_tx_semaphore_handle = xSemaphoreCreateMutex();
+static ring_link_rate_t s_rate;
+static uint32_t s_tx_frames = 0;       // frames put on the link
+static uint32_t s_window_frames;       // s_tx_frames when the window opened
+static uint16_t s_window_errors;       // downstream rx_errors when the window opened
+static bool s_window_known = false;    // the downstream record was known then
+static bool s_window_settle = false;   // the rate just changed, the window is not measured
+static TickType_t s_window_start;
+#endif
+
+static void ring_link_tx_send(ring_link_payload_t *p)
+{
+    ring_link_credit_stamp(p);
+    ring_link_payload_seal(p);
+    esp_err_t rc = RING_LINK_LOWLEVEL_IMPL_TRANSMIT(p, RING_LINK_PAYLOAD_WIRE_LEN(p->len, p->credit_count));
+    if (rc != ESP_OK) {
+        ESP_LOGW(TAG, "Lowlevel transmit failed (%s)", esp_err_to_name(rc));
+    }
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+    s_tx_frames++;
+#endif
+}
+
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+// Mitad bits alternados (el peor caso de flancos), mitad pseudoaleatoria
+static void ring_link_tx_fill_pattern(ring_link_payload_t *p, uint32_t seed)
+{
+    uint32_t x = seed | 1;
+
+    for (size_t i = 0; i < RING_LINK_PAYLOAD_DATA_MAX; i++) {
+        if (i < RING_LINK_PAYLOAD_DATA_MAX / 2) {
+            p->buffer[i] = (i & 1) ? 0xAA : 0x55;
+        } else {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            p->buffer[i] = (char)x;
+        }
+    }
+}
+
+static void ring_link_tx_send_training(void)
+{
+    for (int i = 0; i < RING_LINK_RATE_TRAIN_FRAMES; i++) {
+        ring_link_payload_t *p = RING_LINK_LOWLEVEL_IMPL_ALLOC_TX_BUFFER(pdMS_TO_TICKS(10));
+        if (p == NULL) {
+            break;
+        }
+        p->id = i;
+        p->buffer_type = RING_LINK_PAYLOAD_TYPE_TRAINING;
+        p->len = RING_LINK_PAYLOAD_DATA_MAX;
+        p->ttl = 0;
+        p->src_id = config_get_id();
+        p->dst_id = CONFIG_ID_ANY;
+        p->ctl_seq = 0;
+        p->flags = 0;
+        ring_link_tx_fill_pattern(p, s_tx_frames);
+        ring_link_tx_send(p);
+    }
+}
+
+static void ring_link_tx_rate_open_window(void)
+{
+    s_window_start = xTaskGetTickCount();
+    s_window_frames = s_tx_frames;
+    s_window_known = ring_link_credit_downstream_errors(&s_window_errors);
+    if (ring_link_rate_is_training(&s_rate) && !s_window_settle) {
+        ring_link_tx_send_training();
+    }
+}
+
+// Cierra la ventana de medicion vencida y ajusta el reloj del enlace. Los
+// errores llegan en el registro del vecino, que da la vuelta al anillo: tras
+// cada cambio de reloj se deja pasar una ventana sin medir.
+static TickType_t ring_link_tx_rate_poll(void)
+{
+    bool training = ring_link_rate_is_training(&s_rate);
+    TickType_t period = pdMS_TO_TICKS(training ? RING_LINK_RATE_TRAIN_WINDOW_MS : CONFIG_RING_LINK_RATE_WINDOW_MS);
+    TickType_t elapsed = xTaskGetTickCount() - s_window_start;
+    uint16_t rx_errors;
+
+    if (elapsed < period) {
+        return period - elapsed;
+    }
+
+    uint32_t frames = s_tx_frames - s_window_frames;
+    uint32_t errors = 0;
+    bool known = ring_link_credit_downstream_errors(&rx_errors);
+    if (known) {
+        errors = s_window_known ? (uint16_t)(rx_errors - s_window_errors) : 0;
+    }
+
+    bool settle = s_window_settle;
+    bool changed = false;
+    s_window_settle = false;
+    if (!settle) {
+        // Sin registro del vecino no hay muestra: al arrancar puede no estar
+        // corriendo todavia. Si sigue sin llegar, el reloj baja igual
+        changed = known ? ring_link_rate_update(&s_rate, frames, errors) : ring_link_rate_silent(&s_rate);
+    }
+    if (changed) {
+        int hz = ring_link_rate_hz(&s_rate);
+        if (known) {
+            ESP_LOGI(TAG, "Link %s at %d kHz (%lu errors in %lu frames).",
+                     ring_link_rate_is_training(&s_rate) ? "training" : "clock",
+                     hz / 1000, (unsigned long)errors, (unsigned long)frames);
+        } else {
+            ESP_LOGW(TAG, "Link %s at %d kHz (no report from downstream).",
+                     ring_link_rate_is_training(&s_rate) ? "training" : "clock", hz / 1000);
+        }
+        if (RING_LINK_LOWLEVEL_IMPL_SET_RATE(hz) != ESP_OK) {
+            ESP_LOGE(TAG, "Could not change the link clock");
+        }
+        s_window_settle = true;
+    }
+    ring_link_tx_rate_open_window();
+    return pdMS_TO_TICKS(ring_link_rate_is_training(&s_rate) ? RING_LINK_RATE_TRAIN_WINDOW_MS : CONFIG_RING_LINK_RATE_WINDOW_MS);
+}
+#endif
+
+// Empaqueta detras de p los frames chicos de la misma cola. Solo se esperan
+// mas frames hasta el flush; si no llega ninguno p sale solo, sin copiarse.
+static ring_link_payload_t *ring_link_tx_pack(ring_link_payload_t *p, QueueHandle_t lane)
+{
+#ifdef CONFIG_RING_LINK_AGGREGATE
+    ring_link_payload_t *agg = NULL;
+    ring_link_payload_t *q;
+    TickType_t start = xTaskGetTickCount();
+    const TickType_t flush = pdMS_TO_TICKS(CONFIG_RING_LINK_AGGREGATE_FLUSH_MS);
+
+    if (!ring_link_aggregate_is_candidate(p)) {
+        return p;
+    }
+    while (true) {
+        if (xQueuePeek(lane, &q, 0) != pdTRUE) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            // Los datos no demoran a un frame de control que espera
+            if (elapsed >= flush || (lane == s_tx_data_queue && uxQueueMessagesWaiting(s_tx_ctl_queue) > 0)) {
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, flush - elapsed);
+            continue;
+        }
+        if (!ring_link_aggregate_is_candidate(q) || !ring_link_retransmit_can_send(q)) {
+            break;
+        }
+        if (agg == NULL) {
+            agg = ring_link_lowlevel_alloc_tx_payload();
+            if (agg == NULL) {
+                break;
+            }
+            ring_link_aggregate_start(agg);
+            ring_link_aggregate_append(agg, p);
+        }
+        if (!ring_link_aggregate_fits(agg, q)) {
+            break;
+        }
+        xQueueReceive(lane, &q, 0);
+        ring_link_retransmit_track(q);
+        ring_link_aggregate_append(agg, q);
+        ring_link_lowlevel_free_tx_payload(q);
+    }
+    if (agg != NULL) {
+        ring_link_lowlevel_free_tx_payload(p);
+        return agg;
+    }
+#endif
+    return p;
+}
+
+// Unico dueño del bus. Primero las retransmisiones vencidas, despues la cola
+// de control; un frame de datos sin creditos queda retenido sin bloquear a los
+// de control.
+static void ring_link_tx_task(void *pvParameters)
+{
+    ring_link_payload_t *p;
+    ring_link_payload_t *held = NULL;
+    TickType_t wait;
+
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+    ring_link_tx_rate_open_window();
+#endif
+
+    while (true) {
+        p = ring_link_retransmit_next(&wait);
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+        TickType_t rate_wait = ring_link_tx_rate_poll();
+        if (rate_wait < wait) {
+            wait = rate_wait;
+        }
+#endif
+        if (p != NULL) {
+            ring_link_tx_send(p);
+            continue;
+        }
+        if (xQueuePeek(s_tx_ctl_queue, &p, 0) == pdTRUE && ring_link_retransmit_can_send(p)) {
+            xQueueReceive(s_tx_ctl_queue, &p, 0);
+            ring_link_retransmit_track(p);
+            ring_link_tx_send(ring_link_tx_pack(p, s_tx_ctl_queue));
+            continue;
+        }
+        if (held == NULL && xQueueReceive(s_tx_data_queue, &held, 0) != pdTRUE) {
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+        if (ring_link_credit_available()) {
+            // Un agregado ocupa un solo buffer del vecino
+            ring_link_retransmit_track(held);
+            ring_link_tx_send(ring_link_tx_pack(held, s_tx_data_queue));
+            held = NULL;
+            continue;
+        }
+        // Despierta con un frame de control, con creditos o ACKs nuevos, o
+        // para revisar si el registro del vecino vencio
+        ESP_LOGD(TAG, "Downstream neighbour has no free buffers, holding back payload.");
+        TickType_t credit_wait = pdMS_TO_TICKS(RING_LINK_CREDIT_WAIT_MS);
+        ulTaskNotifyTake(pdTRUE, wait < credit_wait ? wait : credit_wait);
+    }
+}
+
+esp_err_t ring_link_lowlevel_init(QueueHandle_t **rx_queues) {
+    ESP_ERROR_CHECK(RING_LINK_LOWLEVEL_IMPL_INIT(rx_queues));
+
+    s_tx_ctl_queue = xQueueCreate(RING_LINK_TX_QUEUE_SIZE, sizeof(ring_link_payload_t *));
+    s_tx_data_queue = xQueueCreate(RING_LINK_TX_DATA_QUEUE_SIZE, sizeof(ring_link_payload_t *));
+    if (s_tx_ctl_queue == NULL || s_tx_data_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create TX queue");
+        return ESP_FAIL;
+    }
+    ESP_ERROR_CHECK(ring_link_credit_init());
+    ESP_ERROR_CHECK(ring_link_retransmit_init());
+    ESP_ERROR_CHECK(ring_link_aggregate_init());
+
+#ifdef CONFIG_RING_LINK_RATE_ADAPT
+    // Entrenamiento: se arranca en el reloj mas rapido y la tarea de TX baja
+    // hasta que el vecino recibe los patrones de prueba sin errores
+    const int *rates;
+    size_t rate_count = RING_LINK_LOWLEVEL_IMPL_GET_RATES(&rates);
+    ring_link_rate_init(&s_rate, rates, rate_count, CONFIG_RING_LINK_RATE_MAX_FER_PERMILLE);
+    ESP_ERROR_CHECK(RING_LINK_LOWLEVEL_IMPL_SET_RATE(ring_link_rate_hz(&s_rate)));
+#endif
+
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        ring_link_tx_task,
+        "ring_link_tx",
+        TASK_RING_LINK_TX_STACK,
+        NULL,
+        TASK_RING_LINK_TX_PRIORITY,
+        &s_tx_task,
+        TASK_RING_LINK_TX_CORE
+    );
+    if (ret != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        return ESP_FAIL;
+    }
+    ring_link_credit_set_tx_task(s_tx_task);
 
     return ESP_OK;
 }
 
+void ring_link_lowlevel_set_rx_task(TaskHandle_t task)
+{
+    RING_LINK_LOWLEVEL_IMPL_SET_RX_TASK(task);
+}
+
+size_t ring_link_lowlevel_rx_dropped(ring_link_rx_class_t rx_class)
+{
+    return RING_LINK_LOWLEVEL_IMPL_RX_DROP_COUNT(rx_class);
+}
+
+ring_link_payload_t *ring_link_lowlevel_alloc_tx_payload(void)
+{
+    return ring_link_lowlevel_alloc_tx_payload_wait(0);
+}
+
+ring_link_payload_t *ring_link_lowlevel_alloc_tx_payload_wait(TickType_t ticks)
+{
+    return (ring_link_payload_t *)RING_LINK_LOWLEVEL_IMPL_ALLOC_TX_BUFFER(ticks);
+}
+
+esp_err_t ring_link_lowlevel_free_tx_payload(ring_link_payload_t *p)
+{
+    return RING_LINK_LOWLEVEL_IMPL_FREE_TX_BUFFER(p);
+}
+
 esp_err_t ring_link_lowlevel_transmit_payload(ring_link_payload_t *p)
 {
-    esp_err_t rc;
-    p->crc32 = ring_link_compute_crc32(p);
-    if( xSemaphoreTake( s_tx_semaphore_handle, ( TickType_t ) 10 ) == pdTRUE )
-    {
-        rc = RING_LINK_LOWLEVEL_IMPL_TRANSMIT(p, sizeof(ring_link_payload_t));
-        xSemaphoreGive( s_tx_semaphore_handle );
-        return rc;
+    return ring_link_lowlevel_transmit_payload_wait(p, 0);
+}
+
+esp_err_t ring_link_lowlevel_transmit_payload_wait(ring_link_payload_t *p, TickType_t ticks)
+{
+    if (p->len > RING_LINK_PAYLOAD_DATA_MAX) {
+        ESP_LOGE(TAG, "Payload length (%u) exceeds maximum allowed size.", p->len);
+        ring_link_lowlevel_free_tx_payload(p);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Los frames que no vienen del pool se copian a uno
+    if (!RING_LINK_LOWLEVEL_IMPL_IS_TX_BUFFER(p)) {
+        ring_link_payload_t *q = ring_link_lowlevel_alloc_tx_payload_wait(ticks);
+        if (q == NULL) {
+            ESP_LOGD(TAG, "No TX buffer available, rejecting payload.");
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(q, p, RING_LINK_PAYLOAD_COPY_LEN(p));
+        p = q;
+    }
+    QueueHandle_t lane = ring_link_payload_is_control(p) ? s_tx_ctl_queue : s_tx_data_queue;
+    if (xQueueSend(lane, &p, ticks) != pdTRUE) {
+        ring_link_lowlevel_free_tx_payload(p);
+        return ESP_ERR_NO_MEM;
     }
-    ESP_LOGE(TAG, "Could not adquire Mutex...");
-    return ESP_FAIL;
+    xTaskNotifyGive(s_tx_task);
+    return ESP_OK;
 }
 
 esp_err_t ring_link_lowlevel_free_rx_buffer(void *p)
 {
-    return RING_LINK_LOWLEVEL_IMPL_FREE_RX_BUFFER(p);
+    if (ring_link_aggregate_is_sub_payload(p)) {
+        ring_link_aggregate_free_sub_payload(p);
+        return ESP_OK;
+    }
+    if (!RING_LINK_LOWLEVEL_IMPL_IS_RX_BUFFER(p)) {
+        free(p);
+        return ESP_OK;
+    }
+    esp_err_t rc = RING_LINK_LOWLEVEL_IMPL_FREE_RX_BUFFER(p);
+    ring_link_credit_changed();
+    return rc;
 }
 
 esp_err_t ring_link_lowlevel_forward_payload(ring_link_payload_t *p)
 {
+    if (p->flags & RING_LINK_PAYLOAD_FLAG_REASSEMBLED) {
+        return ESP_OK;
+    }
     if (p->ttl <= 0) {
         ESP_LOGW(TAG, "Discarding packet (src=%i,dest=%i,id=%i,ttl=%i) due to TTL. Won't forward.",p->src_id, p->dst_id, p->id, p->ttl);
         return ESP_OK;
@@ -1,13 +1,23 @@
 #include "ring_link_payload.h"
+#include <string.h>
 #include "esp_crc.h"
 
 static const char* TAG = "==> ring_link_payload";
 
+_Static_assert(sizeof(ring_link_payload_t) == RING_LINK_LOWLEVEL_BUFFER_SIZE,
+               "ring_link_payload_t must fill exactly one lowlevel buffer");
+_Static_assert(RING_LINK_PAYLOAD_HEADER_LEN == 20, "RING_LINK_PAYLOAD_DATA_MAX assumes a 20 byte header");
+_Static_assert(RING_LINK_PAYLOAD_DATA_MAX % 4 == 0, "the CRC32 and credit records after the data must be word aligned");
+_Static_assert(RING_LINK_CREDIT_MAX_NODES * sizeof(ring_link_credit_record_t) <= RING_LINK_PAYLOAD_CREDITS_SPACE,
+               "RING_LINK_PAYLOAD_CREDITS_SPACE too small for the credit records");
+
 
 bool ring_link_payload_is_for_device(ring_link_payload_t *p)
 {
+    // Home and root devices both sit at the center
     return p->dst_id == config_get_id() \
-        || (p->dst_id == CONFIG_ID_ANY);
+        || (p->dst_id == CONFIG_ID_ANY) \
+        || (p->dst_id == CONFIG_ID_CENTER && !config_mode_is(CONFIG_MODE_PEER_LINK));
 }
 
 bool ring_link_payload_is_from_device(ring_link_payload_t *p)
@@ -30,6 +40,61 @@ bool ring_link_payload_is_esp_netif(ring_link_payload_t *p)
     return p->buffer_type == RING_LINK_PAYLOAD_TYPE_ESP_NETIF;
 }
 
+bool ring_link_payload_is_link_state(ring_link_payload_t *p)
+{
+    return p->buffer_type == RING_LINK_PAYLOAD_TYPE_LINK_STATE;
+}
+
+bool ring_link_payload_is_aggregate(ring_link_payload_t *p)
+{
+    return p->buffer_type == RING_LINK_PAYLOAD_TYPE_AGGREGATE;
+}
+
+bool ring_link_payload_is_training(ring_link_payload_t *p)
+{
+    return p->buffer_type == RING_LINK_PAYLOAD_TYPE_TRAINING;
+}
+
+bool ring_link_payload_is_control(ring_link_payload_t *p)
+{
+    return ring_link_payload_is_internal(p) || ring_link_payload_is_link_state(p);
+}
+
 uint32_t ring_link_compute_crc32(const ring_link_payload_t *p) {
-    return esp_crc32_le(0, (const uint8_t *)p, RING_LINK_PAYLOAD_CRC_LEN);
+    return esp_crc32_le(0, (const uint8_t *)p->buffer, p->len);
+}
+
+// Cubre toda la cabecera salvo el propio hop_crc, y los registros de credito
+static uint32_t compute_hop_crc32(const ring_link_payload_t *p)
+{
+    const size_t before = offsetof(ring_link_payload_t, hop_crc);
+    const size_t after = before + sizeof(p->hop_crc);
+    uint32_t crc = esp_crc32_le(0, (const uint8_t *)p, before);
+    crc = esp_crc32_le(crc, (const uint8_t *)p + after, RING_LINK_PAYLOAD_HEADER_LEN - after);
+    return esp_crc32_le(crc, (const uint8_t *)ring_link_payload_credits(p),
+                        p->credit_count * sizeof(ring_link_credit_record_t));
+}
+
+void ring_link_payload_seal(ring_link_payload_t *p)
+{
+    if (!(p->flags & RING_LINK_PAYLOAD_FLAG_DATA_CRC)) {
+        uint32_t crc = ring_link_compute_crc32(p);
+        memcpy(p->buffer + p->len, &crc, sizeof(crc));
+    }
+    p->flags &= ~RING_LINK_PAYLOAD_FLAG_DATA_CRC;
+    p->hop_crc = compute_hop_crc32(p);
+}
+
+bool ring_link_payload_header_is_valid(const ring_link_payload_t *p)
+{
+    return p->len <= RING_LINK_PAYLOAD_DATA_MAX && p->credit_count <= RING_LINK_CREDIT_MAX_NODES
+        && p->hop_crc == compute_hop_crc32(p);
+}
+
+bool ring_link_payload_data_is_valid(const ring_link_payload_t *p)
+{
+    uint32_t crc;
+
+    memcpy(&crc, p->buffer + p->len, sizeof(crc));
+    return crc == ring_link_compute_crc32(p);
 }
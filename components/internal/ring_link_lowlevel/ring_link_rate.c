@@ -0,0 +1,102 @@
+#include "ring_link_rate.h"
+
+static bool is_acceptable(const ring_link_rate_t *r, uint32_t frames, uint32_t errors)
+{
+    if (errors > frames) {
+        errors = frames;
+    }
+    return (uint64_t)errors * 1000 <= (uint64_t)frames * r->max_fer_permille;
+}
+
+static void step_down(ring_link_rate_t *r)
+{
+    if (r->probing && r->up_after < RING_LINK_RATE_UP_WINDOWS_MAX) {
+        r->up_after *= 2;
+    }
+    r->index--;
+    r->clean_windows = 0;
+    r->probing = false;
+}
+
+void ring_link_rate_init(ring_link_rate_t *r, const int *ladder, size_t ladder_len, uint32_t max_fer_permille)
+{
+    r->ladder = ladder;
+    r->ladder_len = ladder_len;
+    r->index = ladder_len - 1;
+    r->training = ladder_len > 1;
+    r->probing = false;
+    r->max_fer_permille = max_fer_permille;
+    r->clean_windows = 0;
+    r->up_after = RING_LINK_RATE_UP_WINDOWS;
+    r->silent_windows = 0;
+}
+
+bool ring_link_rate_update(ring_link_rate_t *r, uint32_t frames, uint32_t errors)
+{
+    r->silent_windows = 0;
+    if (frames == 0 && errors == 0) {
+        return false;
+    }
+    bool acceptable = frames > 0 && is_acceptable(r, frames, errors);
+
+    if (r->training) {
+        if (acceptable || r->index == 0) {
+            r->training = false;
+            return false;
+        }
+        step_down(r);
+        return true;
+    }
+
+    if (!acceptable) {
+        if (r->index == 0) {
+            r->clean_windows = 0;
+            return false;
+        }
+        step_down(r);
+        return true;
+    }
+
+    if (errors > 0) {
+        r->clean_windows = 0;
+        return false;
+    }
+    r->clean_windows++;
+    if (r->probing && r->clean_windows >= RING_LINK_RATE_UP_WINDOWS) {
+        // El probe se sostuvo: se olvida el back-off
+        r->probing = false;
+        r->up_after = RING_LINK_RATE_UP_WINDOWS;
+    }
+    if (r->probing || r->clean_windows < r->up_after || r->index + 1 >= r->ladder_len) {
+        return false;
+    }
+    r->index++;
+    r->clean_windows = 0;
+    r->probing = true;
+    return true;
+}
+
+// Sin informe no se sabe si el enlace anda: si es porque va demasiado rapido
+// para traerlo, solo bajando vuelve. Entrenando, se sigue entrenando
+bool ring_link_rate_silent(ring_link_rate_t *r)
+{
+    if (r->silent_windows < RING_LINK_RATE_SILENT_WINDOWS) {
+        r->silent_windows++;
+    }
+    if (r->silent_windows < RING_LINK_RATE_SILENT_WINDOWS || r->index == 0) {
+        return false;
+    }
+    r->silent_windows = 0;
+    step_down(r);
+    return true;
+}
+
+int ring_link_rate_hz(const ring_link_rate_t *r)
+{
+    return r->ladder[r->index];
+}
+
+bool ring_link_rate_is_training(const ring_link_rate_t *r)
+{
+    return r->training;
+}
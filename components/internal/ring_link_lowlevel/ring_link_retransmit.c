@@ -0,0 +1,276 @@
+#include "ring_link_retransmit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/task.h"
+
+#include "ring_link_lowlevel.h"
+
+static const char* TAG = "==> ring_link_retransmit";
+
+typedef struct {
+    ring_link_payload_t *copy;  // header + data as first sent, a fixed buffer of the pool
+    bool used;                  // copy holds a frame not acked yet
+    TickType_t sent;            // tick of the last send
+    uint8_t tries;
+    bool fast;                  // a later frame was acked: resend without waiting the RTO
+} retransmit_slot_t;
+
+// Lado emisor, solo lo toca la tarea de TX
+static retransmit_slot_t s_slots[RING_LINK_RETRANSMIT_WINDOW];  // indexed by ctl_seq
+static uint8_t s_base = 0;      // oldest ctl_seq not acked yet
+static uint8_t s_next = 0;      // ctl_seq of the next new frame
+static TickType_t s_rto = 1;    // retransmission timeout, see ring_link_retransmit_init
+
+// Ultimo ACK del vecino aguas abajo, lo deja ring_link_retransmit_ack
+static portMUX_TYPE s_ack_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_ack_pending = false;
+static uint8_t s_ack = 0;
+static uint8_t s_sack = 0;
+
+// Lado receptor: lo que llego del vecino aguas arriba
+static portMUX_TYPE s_rx_lock = portMUX_INITIALIZER_UNLOCKED;
+static config_id_t s_rx_upstream = CONFIG_ID_NONE;
+static uint8_t s_rx_ack = 0;
+static uint8_t s_rx_sack = 0;
+
+static retransmit_slot_t *slot_of(uint8_t seq)
+{
+    return &s_slots[seq % RING_LINK_RETRANSMIT_WINDOW];
+}
+
+static bool is_acked(uint8_t seq, uint8_t ack, uint8_t sack)
+{
+    uint8_t ahead = (uint8_t)(seq - ack);
+    if ((uint8_t)(ack - seq) < RING_LINK_RETRANSMIT_WINDOW) {
+        return true;
+    }
+    return ahead <= RING_LINK_RETRANSMIT_WINDOW && (sack & (1u << (ahead - 1)));
+}
+
+static void release(retransmit_slot_t *slot)
+{
+    slot->used = false;
+}
+
+static void advance_base(void)
+{
+    while (s_base != s_next && !slot_of(s_base)->used) {
+        s_base++;
+    }
+}
+
+static void apply_ack(void)
+{
+    portENTER_CRITICAL(&s_ack_lock);
+    bool pending = s_ack_pending;
+    uint8_t ack = s_ack;
+    uint8_t sack = s_sack;
+    s_ack_pending = false;
+    portEXIT_CRITICAL(&s_ack_lock);
+    // Un ACK fuera de [s_base - 1, s_next - 1] es de antes de sincronizar
+    if (!pending || (uint8_t)(ack - (uint8_t)(s_base - 1)) > (uint8_t)(s_next - s_base)) {
+        return;
+    }
+
+    // El enlace es FIFO: un hueco antes de un frame ya recibido es una perdida
+    bool later_acked = false;
+    for (uint8_t seq = s_next; seq != s_base; ) {
+        seq--;
+        retransmit_slot_t *slot = slot_of(seq);
+        bool acked = is_acked(seq, ack, sack);
+        later_acked |= acked;
+        if (!slot->used) {
+            continue;
+        }
+        if (acked) {
+            release(slot);
+        } else if (later_acked && slot->tries == 1) {
+            slot->fast = true;
+        }
+    }
+    advance_base();
+}
+
+// El ACK vuelve en el registro del vecino, que da toda la vuelta al anillo.
+// Cada salto puede tardar un frame completo al reloj mas lento de la escala,
+// mas el intervalo minimo entre frames de estado si el enlace esta ocioso
+static TickType_t compute_rto(void)
+{
+    const int *rates;
+    size_t rate_count = RING_LINK_LOWLEVEL_IMPL_GET_RATES(&rates);
+    int slowest = rates[0];
+
+    for (size_t i = 1; i < rate_count; i++) {
+        if (rates[i] < slowest) {
+            slowest = rates[i];
+        }
+    }
+    uint64_t frame_us = (uint64_t)RING_LINK_LOWLEVEL_BUFFER_SIZE * 8 * 1000000 / slowest;
+    uint64_t hop_us = frame_us + (uint64_t)RING_LINK_CREDIT_STATE_MIN_TICKS * portTICK_PERIOD_MS * 1000;
+    uint32_t round_trip_ms = (uint32_t)((RING_LINK_CREDIT_MAX_NODES * hop_us + 999) / 1000);
+
+    return pdMS_TO_TICKS(CONFIG_RING_LINK_RETRANSMIT_RTO_MS + round_trip_ms) + 1;
+}
+
+esp_err_t ring_link_retransmit_init(void)
+{
+    // Tras un reinicio el vecino aun recuerda la secuencia anterior: arrancar
+    // en un punto al azar evita que los primeros frames parezcan duplicados
+    s_base = s_next = (uint8_t)esp_random();
+#ifdef CONFIG_RING_LINK_RETRANSMIT
+    // Una copia fija por frame de la ventana, sin memoria dinamica en la tarea de TX
+    ring_link_payload_t *copies = malloc(RING_LINK_RETRANSMIT_WINDOW * sizeof(ring_link_payload_t));
+    if (copies == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate the retransmit window");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < RING_LINK_RETRANSMIT_WINDOW; i++) {
+        s_slots[i].copy = &copies[i];
+        s_slots[i].used = false;
+    }
+    s_rto = compute_rto();
+    ESP_LOGI(TAG, "Retransmission timeout %lu ms.", (unsigned long)(s_rto * portTICK_PERIOD_MS));
+#endif
+    return ESP_OK;
+}
+
+bool ring_link_retransmit_can_send(ring_link_payload_t *p)
+{
+#ifdef CONFIG_RING_LINK_RETRANSMIT
+    return !ring_link_payload_is_internal(p)
+        || (uint8_t)(s_next - s_base) < RING_LINK_RETRANSMIT_WINDOW;
+#else
+    return true;
+#endif
+}
+
+void ring_link_retransmit_track(ring_link_payload_t *p)
+{
+    p->flags &= ~RING_LINK_PAYLOAD_FLAG_CTL_SEQ;
+    p->ctl_seq = 0;
+#ifdef CONFIG_RING_LINK_RETRANSMIT
+    if (!ring_link_payload_is_internal(p) || !ring_link_credit_downstream_known()) {
+        return;
+    }
+
+    // can_send deja sitio en la ventana, asi que el slot de s_next esta libre
+    retransmit_slot_t *slot = slot_of(s_next);
+    if (slot->used) {
+        ESP_LOGW(TAG, "Retransmit window full, sending internal payload once.");
+        return;
+    }
+    p->flags |= RING_LINK_PAYLOAD_FLAG_CTL_SEQ;
+    p->ctl_seq = s_next++;
+    memcpy(slot->copy, p, RING_LINK_PAYLOAD_COPY_LEN(p));
+    slot->used = true;
+    slot->sent = xTaskGetTickCount();
+    slot->tries = 1;
+    slot->fast = false;
+#endif
+}
+
+ring_link_payload_t *ring_link_retransmit_next(TickType_t *wait)
+{
+    *wait = portMAX_DELAY;
+#ifdef CONFIG_RING_LINK_RETRANSMIT
+    const TickType_t rto = s_rto;
+    TickType_t now = xTaskGetTickCount();
+
+    apply_ack();
+    for (uint8_t seq = s_base; seq != s_next; seq++) {
+        retransmit_slot_t *slot = slot_of(seq);
+        if (!slot->used) {
+            continue;
+        }
+        TickType_t elapsed = now - slot->sent;
+        if (!slot->fast && elapsed < rto) {
+            if (rto - elapsed < *wait) {
+                *wait = rto - elapsed;
+            }
+            continue;
+        }
+        if (slot->tries >= RING_LINK_RETRANSMIT_MAX_TRIES) {
+            ESP_LOGW(TAG, "Internal payload (id=%i,seq=%u) not acknowledged, giving up.",
+                     slot->copy->id, seq);
+            release(slot);
+            continue;
+        }
+
+        ring_link_payload_t *q = ring_link_lowlevel_alloc_tx_payload();
+        if (q == NULL) {
+            *wait = 1;
+            break;
+        }
+        memcpy(q, slot->copy, RING_LINK_PAYLOAD_COPY_LEN(slot->copy));
+        slot->sent = now;
+        slot->tries++;
+        slot->fast = false;
+        ESP_LOGD(TAG, "Retransmitting internal payload (id=%i,seq=%u).", q->id, seq);
+        advance_base();
+        return q;
+    }
+    advance_base();
+#endif
+    return NULL;
+}
+
+void ring_link_retransmit_ack(uint8_t ctl_ack, uint8_t ctl_sack)
+{
+    portENTER_CRITICAL(&s_ack_lock);
+    s_ack = ctl_ack;
+    s_sack = ctl_sack;
+    s_ack_pending = true;
+    portEXIT_CRITICAL(&s_ack_lock);
+}
+
+bool ring_link_retransmit_receive(ring_link_payload_t *p)
+{
+    if (!ring_link_payload_is_internal(p) || !(p->flags & RING_LINK_PAYLOAD_FLAG_CTL_SEQ)) {
+        return true;
+    }
+
+    bool accept = true;
+    uint8_t seq = p->ctl_seq;
+
+    portENTER_CRITICAL(&s_rx_lock);
+    uint8_t ahead = (uint8_t)(seq - s_rx_ack);
+    if (p->hop_src != s_rx_upstream) {
+        // Vecino nuevo: se sincroniza con el primer frame
+        s_rx_upstream = p->hop_src;
+        s_rx_ack = seq;
+        s_rx_sack = 0;
+    } else if ((uint8_t)(s_rx_ack - seq) < RING_LINK_RETRANSMIT_WINDOW) {
+        accept = false;
+    } else if (ahead <= RING_LINK_RETRANSMIT_WINDOW) {
+        uint8_t bit = 1u << (ahead - 1);
+        if (s_rx_sack & bit) {
+            accept = false;
+        } else {
+            s_rx_sack |= bit;
+            while (s_rx_sack & 1) {
+                s_rx_ack++;
+                s_rx_sack >>= 1;
+            }
+        }
+    } else {
+        // Fuera de toda ventana: el vecino se reinicio
+        s_rx_ack = seq;
+        s_rx_sack = 0;
+    }
+    portEXIT_CRITICAL(&s_rx_lock);
+
+    // Tambien ante duplicados: el ACK anterior se perdio y hay que repetirlo
+    ring_link_credit_changed();
+    return accept;
+}
+
+void ring_link_retransmit_get_ack(uint8_t *ctl_ack, uint8_t *ctl_sack)
+{
+    portENTER_CRITICAL(&s_rx_lock);
+    *ctl_ack = s_rx_ack;
+    *ctl_sack = s_rx_sack;
+    portEXIT_CRITICAL(&s_rx_lock);
+}
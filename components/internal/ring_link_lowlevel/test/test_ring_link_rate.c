@@ -0,0 +1,154 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "unity.h"
+#include "ring_link_rate.h"
+
+// Enlace simulado: cada rate de la escala pierde una fraccion fija de frames.
+// Con perdidas de LOST_PERMILLE o mas, el registro del vecino no da la vuelta
+
+#define TEST_MAX_FER_PERMILLE 10
+#define TEST_FRAMES           16    // frames per window, as while training
+#define TEST_LOST_PERMILLE    500
+#define TEST_MAX_WINDOWS      2000
+#define TEST_MAX_BOARDS       5
+
+static const int s_ladder[] = { 8000000, 10000000, 13333333, 16000000, 20000000, 26666666, 40000000, 80000000 };
+#define TEST_LADDER_LEN (sizeof(s_ladder) / sizeof(s_ladder[0]))
+
+typedef struct {
+    ring_link_rate_t rate;
+    uint32_t loss[TEST_LADDER_LEN];  // permille of frames lost at each rate
+} test_link_t;
+
+static void test_link_init(test_link_t *l, size_t clean_index, uint32_t overclock_loss)
+{
+    ring_link_rate_init(&l->rate, s_ladder, TEST_LADDER_LEN, TEST_MAX_FER_PERMILLE);
+    for (size_t i = 0; i < TEST_LADDER_LEN; i++) {
+        l->loss[i] = i <= clean_index ? 0 : overclock_loss;
+    }
+}
+
+static uint32_t test_link_errors(const test_link_t *l, uint32_t frames)
+{
+    return (frames * l->loss[l->rate.index] + 999) / 1000;
+}
+
+// Una ventana para todo el anillo: o cada enlace recibe su informe, o ninguno
+static void run_window(test_link_t *links, int n)
+{
+    bool reports = true;
+
+    for (int i = 0; i < n; i++) {
+        reports &= links[i].loss[links[i].rate.index] < TEST_LOST_PERMILLE;
+    }
+    for (int i = 0; i < n; i++) {
+        if (reports) {
+            ring_link_rate_update(&links[i].rate, TEST_FRAMES, test_link_errors(&links[i], TEST_FRAMES));
+        } else {
+            ring_link_rate_silent(&links[i].rate);
+        }
+    }
+}
+
+static bool any_training(const test_link_t *links, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (ring_link_rate_is_training(&links[i].rate)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void train(test_link_t *links, int n)
+{
+    int windows = 0;
+
+    while (any_training(links, n) && windows < TEST_MAX_WINDOWS) {
+        run_window(links, n);
+        windows++;
+    }
+    TEST_ASSERT_FALSE(any_training(links, n));
+}
+
+TEST_CASE("training picks the fastest clean rate", "[ring_link_rate]")
+{
+    test_link_t link;
+
+    test_link_init(&link, 4, 100);
+    train(&link, 1);
+    TEST_ASSERT_EQUAL(s_ladder[4], ring_link_rate_hz(&link.rate));
+}
+
+TEST_CASE("training ends at the slowest rate if none is clean", "[ring_link_rate]")
+{
+    test_link_t link;
+
+    test_link_init(&link, 0, 100);
+    link.loss[0] = 100;
+    train(&link, 1);
+    TEST_ASSERT_EQUAL(s_ladder[0], ring_link_rate_hz(&link.rate));
+}
+
+TEST_CASE("links too fast to carry reports step down anyway", "[ring_link_rate]")
+{
+    test_link_t links[TEST_MAX_BOARDS];
+
+    // Two links lose every report at the top rates
+    for (int i = 0; i < TEST_MAX_BOARDS; i++) {
+        test_link_init(&links[i], TEST_LADDER_LEN - 1, 0);
+    }
+    test_link_init(&links[1], 3, 1000);
+    test_link_init(&links[3], 5, 1000);
+    train(links, TEST_MAX_BOARDS);
+
+    // Training ends where every report gets through; faster links probe up later
+    for (int i = 0; i < TEST_MAX_BOARDS; i++) {
+        TEST_ASSERT_EQUAL(s_ladder[3], ring_link_rate_hz(&links[i].rate));
+    }
+}
+
+TEST_CASE("silent windows never go below the slowest rate", "[ring_link_rate]")
+{
+    test_link_t link;
+
+    test_link_init(&link, 0, 1000);
+    link.loss[0] = 1000;
+    for (int i = 0; i < TEST_MAX_WINDOWS; i++) {
+        run_window(&link, 1);
+    }
+    TEST_ASSERT_EQUAL(s_ladder[0], ring_link_rate_hz(&link.rate));
+}
+
+TEST_CASE("runtime loss steps down and clean windows probe back up", "[ring_link_rate]")
+{
+    test_link_t link;
+
+    test_link_init(&link, TEST_LADDER_LEN - 1, 0);
+    train(&link, 1);
+    TEST_ASSERT_EQUAL(s_ladder[TEST_LADDER_LEN - 1], ring_link_rate_hz(&link.rate));
+
+    // The top two rates start losing frames
+    link.loss[TEST_LADDER_LEN - 1] = 100;
+    link.loss[TEST_LADDER_LEN - 2] = 100;
+    for (int i = 0; i < 5; i++) {
+        run_window(&link, 1);
+    }
+    TEST_ASSERT_EQUAL(s_ladder[TEST_LADDER_LEN - 3], ring_link_rate_hz(&link.rate));
+
+    // Probes fail and back off, but never stay on a lossy rate
+    for (int i = 0; i < TEST_MAX_WINDOWS; i++) {
+        run_window(&link, 1);
+        TEST_ASSERT_TRUE(link.rate.index <= TEST_LADDER_LEN - 2);
+    }
+    TEST_ASSERT_TRUE(link.rate.up_after > RING_LINK_RATE_UP_WINDOWS);
+
+    // Once the loss is gone the top rate comes back
+    link.loss[TEST_LADDER_LEN - 1] = 0;
+    link.loss[TEST_LADDER_LEN - 2] = 0;
+    for (int i = 0; i < TEST_MAX_WINDOWS; i++) {
+        run_window(&link, 1);
+    }
+    TEST_ASSERT_EQUAL(s_ladder[TEST_LADDER_LEN - 1], ring_link_rate_hz(&link.rate));
+}
@@ -50,6 +50,64 @@ esp_netif_t* ring_link_netif_new(const esp_netif_config_t* config);
 
 esp_err_t ring_link_netif_esp_netif_attach(esp_netif_t *esp_netif, esp_err_t (*post_attach_callback)(esp_netif_t *, void *));
 
+/**
+ * @brief Returns the ring device that should take an outgoing IP packet.
+ *
+ * CONFIG_ID_ANY lets the first device on the ring take it up to lwIP, as
+ * every packet did before destinations were resolved. Only the first
+ * RING_LINK_NETIF_HC_MAX_HEADER bytes of `packet` are guaranteed to be
+ * readable; `len` is the length of the whole packet.
+ */
+typedef config_id_t (*ring_link_netif_dst_resolver_t)(const uint8_t *packet, size_t len);
+
+void ring_link_netif_set_dst_resolver(ring_link_netif_dst_resolver_t resolver);
+
+/**
+ * @brief Sends an IP packet onto the ring.
+ *
+ * The packet is written straight into a DMA-capable payload from the lowlevel
+ * TX pool, so no ring_link_payload_t is built on the caller's stack. Packets
+ * larger than one frame go out as fragments.
+ */
+esp_err_t ring_link_netif_transmit(ring_link_payload_id_t id, const void *buffer, size_t len);
+
+/**
+ * @brief Sends a pbuf chain onto the ring.
+ *
+ * The segments are gathered straight into the TX frames, so a chain costs a
+ * single copy, the same as a packet in one pbuf.
+ *
+ * @param wait Time to wait for a free TX buffer before rejecting the packet
+ *             with ESP_ERR_NO_MEM.
+ */
+esp_err_t ring_link_netif_transmit_pbuf(ring_link_payload_id_t id, struct pbuf *p, TickType_t wait);
+
+// Checksums lwIP still handles on the ring interfaces: only generation, since
+// forwarding never recomputes them and a packet may leave through Wi-Fi
+#define RING_LINK_NETIF_CHECKSUM_FLAGS (NETIF_CHECKSUM_ENABLE_ALL & ~(NETIF_CHECKSUM_CHECK_IP   \
+                                                                      | NETIF_CHECKSUM_CHECK_UDP \
+                                                                      | NETIF_CHECKSUM_CHECK_TCP \
+                                                                      | NETIF_CHECKSUM_CHECK_ICMP))
+
+#define RING_LINK_NETIF_TX_QUEUE_SIZE 16  // packets lwIP may leave for the ring before getting ERR_MEM
+#define RING_LINK_NETIF_TX_WAIT_MS    50  // time a packet waits for a free ring TX buffer
+
+/**
+ * @brief Starts the task that moves queued lwIP packets onto the ring.
+ */
+esp_err_t ring_link_netif_output_init(void);
+
+/**
+ * @brief Queues an outgoing lwIP packet for the ring, without blocking.
+ *
+ * Called from linkoutput on the tcpip thread. The pbuf is referenced until
+ * the netif TX task has copied it into ring frames, so lwIP keeps serving
+ * other interfaces while the ring drains.
+ *
+ * @return ERR_MEM when the queue is full.
+ */
+err_t ring_link_netif_output(ring_link_payload_id_t id, struct pbuf *p);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ring_link_netif_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_LINK_NETIF_HC_CONTEXTS    8   // compression contexts per source board
+#define RING_LINK_NETIF_HC_FULL_REPEAT 3   // packets sent with the full header when a context starts
+#define RING_LINK_NETIF_HC_REFRESH     32  // packets between full-header refreshes of a context
+#define RING_LINK_NETIF_HC_ASKED_GAP   4   // least packets between two refreshes asked by the destination
+#define RING_LINK_NETIF_HC_MAX_HEADER  (IP_HLEN + TCP_HLEN)
+
+/**
+ * @brief IPv4 TCP/UDP header compression between two boards of the ring.
+ *
+ * Only plain headers are compressed: IPv4 without options or fragments,
+ * carrying TCP without options or UDP. The source keeps one context per flow
+ * and destination board, the destination one per flow and source board.
+ * Boards in between forward compressed frames untouched.
+ *
+ * A context starts with a few packets carrying the full header
+ * (RING_LINK_PAYLOAD_FLAG_HC_FULL). The following ones carry only the fields
+ * that change from packet to packet, verbatim, so a lost packet never
+ * desynchronises the context. A destination that drops a packet for lack
+ * of context asks the source for its full headers in its credit record, and
+ * the source refreshes its contexts for that board, at most once every
+ * RING_LINK_NETIF_HC_ASKED_GAP packets, until the request is withdrawn. The
+ * full header is also sent again every RING_LINK_NETIF_HC_REFRESH packets.
+ * The TCP/UDP checksum travels unchanged and still covers the rebuilt header.
+ */
+
+/**
+ * @brief Writes the compressed header of a packet into `out`.
+ *
+ * Only the header is read, so the rest of the packet may sit in other pbufs.
+ * The caller appends the packet from byte `*consumed` on after the bytes
+ * written.
+ *
+ * @param packet First min(len, RING_LINK_NETIF_HC_MAX_HEADER) bytes of the packet.
+ * @param len Length of the whole packet.
+ * @param out Buffer of at least RING_LINK_PAYLOAD_DATA_MAX bytes.
+ * @param[out] flags Payload flags describing the result.
+ * @param[out] consumed Packet bytes replaced by what was written.
+ * @return Bytes written, 0 if the packet must be sent as is.
+ */
+size_t ring_link_netif_hc_compress(config_id_t dst_id, const uint8_t *packet, size_t len,
+                                   uint8_t *out, uint8_t *flags, size_t *consumed);
+
+/**
+ * @brief Restores the IP packet of a received payload.
+ *
+ * Takes ownership of `p`. A payload without compressed header is returned as
+ * is; otherwise the returned payload may be a new heap copy.
+ *
+ * @return NULL if the packet was dropped: its context is unknown or it is malformed.
+ */
+ring_link_payload_t *ring_link_netif_hc_decompress(ring_link_payload_t *p);
+
+#ifdef __cplusplus
+}
+#endif
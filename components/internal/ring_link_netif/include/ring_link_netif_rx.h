@@ -11,6 +11,15 @@ ESP_EVENT_DECLARE_BASE(RING_LINK_RX_EVENT);
 
 esp_err_t ring_link_rx_netif_init(void);
 
+// RX buffers that may be lent to lwIP at once; beyond this packets are copied
+#define RING_LINK_RX_NETIF_LOAN_MAX (RING_LINK_LOWLEVEL_RX_BUFFERS / 2)
+
+/**
+ * @brief Passes the IP packet in `p` to lwIP.
+ *
+ * Takes ownership of `p`: it is either lent to lwIP as a custom pbuf, and
+ * returned to the lowlevel pool when lwIP frees it, or freed here.
+ */
 esp_err_t ring_link_rx_netif_receive(ring_link_payload_t *p);
 
 err_t ring_link_rx_netstack_lwip_init_fn(struct netif *netif);
@@ -14,6 +14,7 @@ static esp_err_t ring_link_netif_handler(ring_link_payload_t *p)
     else  // not for me, warn and discard
     {
         ESP_LOGW(TAG, "Discarding packet. id '%i' ('%s').", p->id, p->buffer);
+        ring_link_lowlevel_free_rx_buffer(p);
         return ESP_OK;        
     }
 }
@@ -25,9 +26,8 @@ static void ring_link_netif_process_task(void *pvParameters)
     
     while (true) {
         if (xQueueReceive(ring_link_netif_queue, &payload, portMAX_DELAY) == pdTRUE) {
-            rc = ring_link_netif_handler(payload);
+            rc = ring_link_netif_handler(payload);  // the handler owns payload
             // ESP_ERROR_CHECK_WITHOUT_ABORT(rc);
-            ring_link_lowlevel_free_rx_buffer(payload);
             taskYIELD();
         }
     }
@@ -35,6 +35,7 @@ static void ring_link_netif_process_task(void *pvParameters)
 
 esp_err_t ring_link_netif_init(QueueHandle_t **queue)
 {
+    ESP_ERROR_CHECK(ring_link_netif_output_init());
     ESP_ERROR_CHECK(ring_link_rx_netif_init());
     ESP_ERROR_CHECK(ring_link_tx_netif_init());
 
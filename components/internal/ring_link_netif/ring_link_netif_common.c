@@ -1,7 +1,18 @@
 #include "ring_link_netif_common.h"
+#include "ring_link_netif_hc.h"
+#include "task_config.h"
 
 static const char* TAG = "==> ring_link_netif_common";
 
+static ring_link_netif_dst_resolver_t s_dst_resolver = NULL;
+
+typedef struct {
+    struct pbuf *p;
+    ring_link_payload_id_t id;
+} ring_link_netif_tx_item_t;
+
+static QueueHandle_t s_tx_queue = NULL;
+
 esp_netif_t* ring_link_netif_new(const esp_netif_config_t* config)
 {
     esp_netif_t *netif = esp_netif_new(config);
@@ -34,3 +45,136 @@ esp_err_t ring_link_netif_esp_netif_attach(esp_netif_t * esp_netif, esp_err_t (*
 
     return esp_netif_attach(esp_netif, driver);
 }
+
+void ring_link_netif_set_dst_resolver(ring_link_netif_dst_resolver_t resolver)
+{
+    s_dst_resolver = resolver;
+}
+
+static void gather_buffer(void *ctx, size_t offset, void *dst, size_t len)
+{
+    memcpy(dst, (const uint8_t *)ctx + offset, len);
+}
+
+static void gather_pbuf(void *ctx, size_t offset, void *dst, size_t len)
+{
+    pbuf_copy_partial((const struct pbuf *)ctx, dst, len, offset);
+}
+
+// El paquete se lee con gather y se copia una sola vez, directo a las tramas.
+// `header` tiene los primeros bytes contiguos, para el resolver y la compresion
+static esp_err_t ring_link_netif_transmit_gather(ring_link_payload_id_t id, const uint8_t *header, size_t len,
+                                                 TickType_t wait, ring_link_fragment_gather_t gather, void *ctx)
+{
+    if (len > RING_LINK_NETIF_MTU) {
+        ESP_LOGE(TAG, "Buffer length exceeds maximum allowed size.");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    config_id_t dst_id = s_dst_resolver ? s_dst_resolver(header, len) : CONFIG_ID_ANY;
+    if (len > RING_LINK_PAYLOAD_DATA_MAX) {
+        return ring_link_fragment_transmit_gather(RING_LINK_PAYLOAD_TYPE_ESP_NETIF, id, dst_id, 0, len, wait, gather, ctx);
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    ring_link_payload_t *p = ring_link_lowlevel_alloc_tx_payload_wait(wait);
+    if (p == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->id = id;
+    p->ttl = RING_LINK_PAYLOAD_TTL;
+    p->src_id = config_get_id();
+    p->dst_id = dst_id;
+    p->buffer_type = RING_LINK_PAYLOAD_TYPE_ESP_NETIF;
+    p->len = len;
+    p->flags = 0;
+#ifdef CONFIG_RING_LINK_NETIF_HC
+    size_t consumed = 0;
+    size_t hc_len = ring_link_netif_hc_compress(dst_id, header, len, (uint8_t *)p->buffer, &p->flags, &consumed);
+    if (hc_len > 0) {
+        gather(ctx, consumed, p->buffer + hc_len, len - consumed);
+        p->len = hc_len + len - consumed;
+    } else {
+        gather(ctx, 0, p->buffer, len);
+    }
+#else
+    gather(ctx, 0, p->buffer, len);
+#endif
+    TickType_t spent = xTaskGetTickCount() - start;
+    return ring_link_lowlevel_transmit_payload_wait(p, spent < wait ? wait - spent : 0);
+}
+
+esp_err_t ring_link_netif_transmit(ring_link_payload_id_t id, const void *buffer, size_t len)
+{
+    return ring_link_netif_transmit_gather(id, buffer, len, 0, gather_buffer, (void *)buffer);
+}
+
+esp_err_t ring_link_netif_transmit_pbuf(ring_link_payload_id_t id, struct pbuf *p, TickType_t wait)
+{
+    uint8_t header[RING_LINK_NETIF_HC_MAX_HEADER];
+    const uint8_t *contiguous = p->payload;
+    size_t header_len = p->tot_len < sizeof(header) ? p->tot_len : sizeof(header);
+
+    // Solo la cabecera se junta en la pila si quedo partida entre pbufs
+    if (p->len < header_len) {
+        pbuf_copy_partial(p, header, header_len, 0);
+        contiguous = header;
+    }
+    return ring_link_netif_transmit_gather(id, contiguous, p->tot_len, wait, gather_pbuf, p);
+}
+
+static void ring_link_netif_output_task(void *pvParameters)
+{
+    ring_link_netif_tx_item_t item;
+
+    while (true) {
+        if (xQueueReceive(s_tx_queue, &item, portMAX_DELAY) == pdTRUE) {
+            // Con el pool de TX del anillo lleno se espera: la cola hace de buffer y
+            // lwIP recien ve ERR_MEM cuando tambien ella se llena
+            esp_err_t rc = ring_link_netif_transmit_pbuf(item.id, item.p, pdMS_TO_TICKS(RING_LINK_NETIF_TX_WAIT_MS));
+            if (rc != ESP_OK) {
+                ESP_LOGD(TAG, "Packet id '%i' not sent (%s).", item.id, esp_err_to_name(rc));
+            }
+            pbuf_free(item.p);
+        }
+    }
+}
+
+esp_err_t ring_link_netif_output_init(void)
+{
+    s_tx_queue = xQueueCreate(RING_LINK_NETIF_TX_QUEUE_SIZE, sizeof(ring_link_netif_tx_item_t));
+    if (s_tx_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create TX queue");
+        return ESP_FAIL;
+    }
+
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        ring_link_netif_output_task,
+        "ring_link_netif_tx",
+        TASK_RING_LINK_NETIF_TX_STACK,
+        NULL,
+        TASK_RING_LINK_NETIF_TX_PRIORITY,
+        NULL,
+        TASK_RING_LINK_NETIF_TX_CORE
+    );
+    if (ret != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to create netif TX task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+err_t ring_link_netif_output(ring_link_payload_id_t id, struct pbuf *p)
+{
+    ring_link_netif_tx_item_t item = {
+        .p = p,
+        .id = id,
+    };
+
+    pbuf_ref(p);
+    if (xQueueSend(s_tx_queue, &item, 0) != pdTRUE) {
+        pbuf_free(p);
+        return ERR_MEM;
+    }
+    return ERR_OK;
+}
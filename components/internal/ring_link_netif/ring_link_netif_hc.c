@@ -0,0 +1,286 @@
+#include "ring_link_netif_hc.h"
+
+#include <stdlib.h>
+#include "esp_random.h"
+
+static const char* TAG = "==> ring_link_netif_hc";
+
+// Cabecera que precede a los datos de un frame comprimido
+#define HC_CTX     0  // context index
+#define HC_GEN     1  // context generation
+#define HC_PREFIX  4  // a full header is preceded by ctx, gen and two bytes of padding
+
+// Campos que viajan en cada paquete comprimido, offsets en la cabecera original
+#define IP_ID_OFFSET       4
+#define IP_CHKSUM_OFFSET   10
+#define TCP_SEQ_OFFSET     (IP_HLEN + 4)   // seqno and ackno
+#define TCP_FLAGS_OFFSET   (IP_HLEN + 13)
+#define TCP_WND_OFFSET     (IP_HLEN + 14)  // wnd and chksum
+#define UDP_LEN_OFFSET     (IP_HLEN + 4)
+#define UDP_CHKSUM_OFFSET  (IP_HLEN + 6)
+
+#define TCP_COMPRESSED_LEN (2 + 2 + 8 + 1 + 4)  // ctx/gen, ip id, seq/ack, flags, wnd/chksum
+#define UDP_COMPRESSED_LEN (2 + 2 + 2)          // ctx/gen, ip id, chksum
+
+typedef struct {
+    config_id_t dst_id;          // CONFIG_ID_NONE if the context is free
+    uint8_t gen;
+    uint8_t header_len;
+    uint8_t full_left;           // packets still to send with the full header
+    uint8_t since_refresh;
+    uint32_t last_used;
+    uint8_t base[RING_LINK_NETIF_HC_MAX_HEADER];  // header with the changing fields zeroed
+} hc_tx_context_t;
+
+typedef struct {
+    bool valid;
+    uint8_t gen;
+    uint8_t header_len;
+    uint8_t base[RING_LINK_NETIF_HC_MAX_HEADER];
+} hc_rx_context_t;
+
+static portMUX_TYPE s_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static hc_tx_context_t s_tx[RING_LINK_NETIF_HC_CONTEXTS];
+static uint32_t s_tx_clock = 0;  // orders the use of the TX contexts
+static bool s_tx_ready = false;
+
+// Solo la tarea de esp_netif descomprime
+static hc_rx_context_t s_rx[RING_LINK_CREDIT_MAX_NODES][RING_LINK_NETIF_HC_CONTEXTS];
+
+// Largo de la cabecera comprimible, 0 si el paquete no lo es
+static size_t hc_header_len(const uint8_t *packet, size_t len)
+{
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)packet;
+
+    if (len < IP_HLEN || IPH_V(iphdr) != 4 || IPH_HL(iphdr) != 5
+        || (lwip_ntohs(IPH_OFFSET(iphdr)) & (IP_MF | IP_OFFMASK)) != 0
+        || lwip_ntohs(IPH_LEN(iphdr)) != len) {
+        return 0;
+    }
+    if (IPH_PROTO(iphdr) == IP_PROTO_TCP && len >= IP_HLEN + TCP_HLEN) {
+        const struct tcp_hdr *tcphdr = (const struct tcp_hdr *)(packet + IP_HLEN);
+        return TCPH_HDRLEN(tcphdr) == 5 ? IP_HLEN + TCP_HLEN : 0;
+    }
+    if (IPH_PROTO(iphdr) == IP_PROTO_UDP && len >= IP_HLEN + UDP_HLEN) {
+        return IP_HLEN + UDP_HLEN;
+    }
+    return 0;
+}
+
+// Copia la cabecera dejando en cero los campos que viajan en cada paquete
+static void hc_mask(uint8_t *base, const uint8_t *packet, size_t header_len)
+{
+    memcpy(base, packet, header_len);
+    memset(base + 2, 0, 4);  // total length and id
+    memset(base + IP_CHKSUM_OFFSET, 0, 2);
+    if (base[9] == IP_PROTO_TCP) {
+        memset(base + TCP_SEQ_OFFSET, 0, 8);
+        memset(base + TCP_FLAGS_OFFSET, 0, 5);
+    } else {
+        memset(base + UDP_LEN_OFFSET, 0, 4);
+    }
+}
+
+// Busca el contexto del flujo, o recicla el menos usado para uno nuevo
+static hc_tx_context_t *hc_tx_context(config_id_t dst_id, const uint8_t *base, size_t header_len)
+{
+    hc_tx_context_t *lru = &s_tx[0];
+
+    if (!s_tx_ready) {
+        for (int i = 0; i < RING_LINK_NETIF_HC_CONTEXTS; i++) {
+            s_tx[i].dst_id = CONFIG_ID_NONE;
+            s_tx[i].gen = (uint8_t)esp_random();
+        }
+        s_tx_ready = true;
+    }
+    for (int i = 0; i < RING_LINK_NETIF_HC_CONTEXTS; i++) {
+        hc_tx_context_t *ctx = &s_tx[i];
+        if (ctx->dst_id == dst_id && ctx->header_len == header_len && memcmp(ctx->base, base, header_len) == 0) {
+            return ctx;
+        }
+        if (ctx->last_used < lru->last_used) {
+            lru = ctx;
+        }
+    }
+    lru->dst_id = dst_id;
+    lru->gen++;
+    lru->header_len = header_len;
+    lru->full_left = RING_LINK_NETIF_HC_FULL_REPEAT;
+    lru->since_refresh = 0;
+    memcpy(lru->base, base, header_len);
+    return lru;
+}
+
+size_t ring_link_netif_hc_compress(config_id_t dst_id, const uint8_t *packet, size_t len,
+                                   uint8_t *out, uint8_t *flags, size_t *consumed)
+{
+    uint8_t base[RING_LINK_NETIF_HC_MAX_HEADER];
+    size_t header_len = hc_header_len(packet, len);
+    bool full;
+    uint8_t index;
+    uint8_t gen;
+
+    // Un destino ANY lo toma siempre el hermano siguiente, que guarda el contexto
+    if (header_len == 0 || len + HC_PREFIX > RING_LINK_PAYLOAD_DATA_MAX) {
+        return 0;
+    }
+    hc_mask(base, packet, header_len);
+    bool asked = ring_link_credit_refresh_requested(dst_id);
+
+    portENTER_CRITICAL(&s_tx_lock);
+    hc_tx_context_t *ctx = hc_tx_context(dst_id, base, header_len);
+    ctx->last_used = ++s_tx_clock;
+    // El destino perdio algun contexto de esta placa y pide las cabeceras completas
+    if (++ctx->since_refresh >= RING_LINK_NETIF_HC_REFRESH
+        || (asked && ctx->since_refresh >= RING_LINK_NETIF_HC_ASKED_GAP)) {
+        ctx->since_refresh = 0;
+        if (ctx->full_left == 0) {
+            ctx->full_left = 1;
+        }
+    }
+    full = ctx->full_left > 0;
+    if (full) {
+        ctx->full_left--;
+    }
+    index = ctx - s_tx;
+    gen = ctx->gen;
+    portEXIT_CRITICAL(&s_tx_lock);
+
+    out[HC_CTX] = index;
+    out[HC_GEN] = gen;
+    if (full) {
+        out[2] = 0;
+        out[3] = 0;
+        *flags = RING_LINK_PAYLOAD_FLAG_HC_FULL;
+        *consumed = 0;
+        return HC_PREFIX;
+    }
+
+    size_t n = 2;
+    memcpy(out + n, packet + IP_ID_OFFSET, 2);
+    n += 2;
+    if (packet[9] == IP_PROTO_TCP) {
+        memcpy(out + n, packet + TCP_SEQ_OFFSET, 8);
+        n += 8;
+        out[n++] = packet[TCP_FLAGS_OFFSET];
+        memcpy(out + n, packet + TCP_WND_OFFSET, 4);
+        n += 4;
+    } else {
+        memcpy(out + n, packet + UDP_CHKSUM_OFFSET, 2);
+        n += 2;
+    }
+    *flags = RING_LINK_PAYLOAD_FLAG_HC;
+    *consumed = header_len;
+    return n;
+}
+
+static hc_rx_context_t *hc_rx_context(const ring_link_payload_t *p)
+{
+    uint8_t index = (uint8_t)p->buffer[HC_CTX];
+
+    if (p->src_id >= RING_LINK_CREDIT_MAX_NODES || index >= RING_LINK_NETIF_HC_CONTEXTS) {
+        return NULL;
+    }
+    return &s_rx[p->src_id][index];
+}
+
+static ring_link_payload_t *hc_receive_full(ring_link_payload_t *p)
+{
+    hc_rx_context_t *ctx = hc_rx_context(p);
+    const uint8_t *packet = (const uint8_t *)p->buffer + HC_PREFIX;
+    size_t len = p->len - HC_PREFIX;
+    size_t header_len = hc_header_len(packet, len);
+
+    if (ctx == NULL || header_len == 0) {
+        ESP_LOGW(TAG, "Malformed full header from %d, dropping.", p->src_id);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+    ctx->valid = true;
+    ctx->gen = (uint8_t)p->buffer[HC_GEN];
+    ctx->header_len = header_len;
+    hc_mask(ctx->base, packet, header_len);
+    ring_link_credit_set_refresh(p->src_id, false);
+
+    // El paquete queda alineado al principio del buffer, como llega sin comprimir
+    memmove(p->buffer, packet, len);
+    p->len = len;
+    p->flags &= ~RING_LINK_PAYLOAD_FLAG_HC_FULL;
+    return p;
+}
+
+static ring_link_payload_t *hc_receive_compressed(ring_link_payload_t *p)
+{
+    hc_rx_context_t *ctx = p->len >= 2 ? hc_rx_context(p) : NULL;
+
+    if (ctx == NULL || !ctx->valid || ctx->gen != (uint8_t)p->buffer[HC_GEN]) {
+        ESP_LOGD(TAG, "No context for compressed packet from %d, dropping.", p->src_id);
+        ring_link_credit_set_refresh(p->src_id, true);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+    bool tcp = ctx->base[9] == IP_PROTO_TCP;
+    size_t fields_len = tcp ? TCP_COMPRESSED_LEN : UDP_COMPRESSED_LEN;
+    if (p->len < fields_len) {
+        ESP_LOGW(TAG, "Compressed packet from %d too short, dropping.", p->src_id);
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+    size_t data_len = p->len - fields_len;
+    size_t len = ctx->header_len + data_len;
+
+    // La cabecera reconstruida es mas larga que la comprimida: nuevo buffer
+    ring_link_payload_t *q = malloc(RING_LINK_PAYLOAD_HEADER_LEN + len);
+    if (q == NULL) {
+        ESP_LOGW(TAG, "No memory to decompress packet, dropping.");
+        ring_link_lowlevel_free_rx_buffer(p);
+        return NULL;
+    }
+    memcpy(q, p, RING_LINK_PAYLOAD_HEADER_LEN);
+    q->len = len;
+    q->flags &= ~RING_LINK_PAYLOAD_FLAG_HC;
+
+    uint8_t *packet = (uint8_t *)q->buffer;
+    const uint8_t *in = (const uint8_t *)p->buffer + 2;
+    u16_t field;
+
+    memcpy(packet, ctx->base, ctx->header_len);
+    field = lwip_htons(len);
+    memcpy(packet + 2, &field, 2);
+    memcpy(packet + IP_ID_OFFSET, in, 2);
+    in += 2;
+    if (tcp) {
+        memcpy(packet + TCP_SEQ_OFFSET, in, 8);
+        in += 8;
+        packet[TCP_FLAGS_OFFSET] = *in++;
+        memcpy(packet + TCP_WND_OFFSET, in, 4);
+        in += 4;
+    } else {
+        field = lwip_htons(len - IP_HLEN);
+        memcpy(packet + UDP_LEN_OFFSET, &field, 2);
+        memcpy(packet + UDP_CHKSUM_OFFSET, in, 2);
+        in += 2;
+    }
+    field = inet_chksum(packet, IP_HLEN);
+    memcpy(packet + IP_CHKSUM_OFFSET, &field, 2);
+    memcpy(packet + ctx->header_len, in, data_len);
+
+    ring_link_lowlevel_free_rx_buffer(p);
+    return q;
+}
+
+ring_link_payload_t *ring_link_netif_hc_decompress(ring_link_payload_t *p)
+{
+    if (p->flags & RING_LINK_PAYLOAD_FLAG_HC_FULL) {
+        if (p->len < HC_PREFIX) {
+            ESP_LOGW(TAG, "Full header from %d shorter than its prefix, dropping.", p->src_id);
+            ring_link_lowlevel_free_rx_buffer(p);
+            return NULL;
+        }
+        return hc_receive_full(p);
+    }
+    if (p->flags & RING_LINK_PAYLOAD_FLAG_HC) {
+        return hc_receive_compressed(p);
+    }
+    return p;
+}
@@ -1,4 +1,6 @@
 #include "ring_link_netif_rx.h"
+#include "ring_link_netif_hc.h"
+#include "freertos/queue.h"
 
 static const char* TAG = "==> ring_link_netif_rx";
 
@@ -7,6 +9,23 @@ ESP_EVENT_DEFINE_BASE(RING_LINK_RX_EVENT);
 static esp_netif_t *ring_link_rx_netif = NULL;
 static ring_link_payload_id_t s_id_counter_rx = 0;
 
+// El pbuf prestado apunta a los datos con el hueco para la cabecera de enlace
+// delante, sobre la cabecera del anillo que ya no se usa. Los datos quedan
+// contiguos, como en un PBUF_RAM, asi que lwIP puede anadirles la cabecera
+// Ethernet y reenviarlos por Wi-Fi
+#define RING_LINK_RX_LINK_ROOM LWIP_MEM_ALIGN_SIZE(PBUF_LINK)
+_Static_assert(RING_LINK_RX_LINK_ROOM <= RING_LINK_PAYLOAD_HEADER_LEN,
+               "ring header too short for the link header");
+
+typedef struct {
+    struct pbuf_custom pc;       // first: lwIP hands it back as the pbuf
+    ring_link_payload_t *payload;
+} ring_link_rx_loan_t;
+
+// Prestamos libres: cada buffer prestado es un buffer de RX menos para el driver
+static ring_link_rx_loan_t s_rx_loans[RING_LINK_RX_NETIF_LOAN_MAX];
+static QueueHandle_t s_rx_loan_pool = NULL;
+
 static const struct esp_netif_netstack_config netif_netstack_config = {
     .lwip = {
         .init_fn = ring_link_rx_netstack_lwip_init_fn,
@@ -32,14 +51,59 @@ static const esp_netif_config_t netif_config = {
     .stack = &netif_netstack_config,
 };
 
+// Devuelve el buffer de SPI al pool cuando lwIP libera el pbuf
+static void ring_link_rx_pbuf_free(struct pbuf *q)
+{
+    ring_link_rx_loan_t *loan = (ring_link_rx_loan_t *)q;
+
+    ring_link_lowlevel_free_rx_buffer(loan->payload);
+    xQueueSend(s_rx_loan_pool, &loan, 0);
+}
+
+// Presta el buffer a lwIP si quedan prestamos, si no copia el paquete
+static struct pbuf *ring_link_rx_pbuf_from_payload(ring_link_payload_t *p, u16_t len)
+{
+    ring_link_rx_loan_t *loan;
+    struct pbuf *q;
+
+    if (xQueueReceive(s_rx_loan_pool, &loan, 0) == pdTRUE) {
+        // El hueco pisa la cabecera del anillo: p ya solo se usa por sus datos
+        loan->payload = p;
+        loan->pc.custom_free_function = ring_link_rx_pbuf_free;
+        q = pbuf_alloced_custom(
+            PBUF_LINK, len, PBUF_RAM, &loan->pc,
+            (uint8_t *)p->buffer - RING_LINK_RX_LINK_ROOM, len + RING_LINK_RX_LINK_ROOM
+        );
+        if (q != NULL) {
+            return q;
+        }
+        xQueueSend(s_rx_loan_pool, &loan, 0);
+    }
+
+    q = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (q != NULL) {
+        memcpy(q->payload, p->buffer, len);
+    }
+    ring_link_lowlevel_free_rx_buffer(p);
+    return q;
+}
+
 esp_err_t ring_link_rx_netif_receive(ring_link_payload_t *p)
 {
     struct pbuf *q;
     struct ip_hdr *ip_header;
     esp_err_t error;
 
+#ifdef CONFIG_RING_LINK_NETIF_HC
+    p = ring_link_netif_hc_decompress(p);
+    if (p == NULL) {
+        return ESP_OK;
+    }
+#endif
+
     if (p->len <= 0 || p->len < IP_HLEN) {
         ESP_LOGW(TAG, "Discarding invalid payload.");
+        ring_link_lowlevel_free_rx_buffer(p);
         return ESP_OK;
     }
 
@@ -47,6 +111,7 @@ esp_err_t ring_link_rx_netif_receive(ring_link_payload_t *p)
 
     if (!((IPH_V(ip_header) == 4) || (IPH_V(ip_header) == 6))) {
         ESP_LOGW(TAG, "Discarding non-IP payload.");
+        ring_link_lowlevel_free_rx_buffer(p);
         return ESP_OK;
     }
 
@@ -91,22 +156,17 @@ esp_err_t ring_link_rx_netif_receive(ring_link_payload_t *p)
     // Validate that payload size is sufficient
     if (iphdr_len > p->len) {
         ESP_LOGW(TAG, "Payload size (%d) is smaller than IP length (%d). Discarding packet.", p->len, iphdr_len);
+        ring_link_lowlevel_free_rx_buffer(p);
         return ESP_OK;
     }
 
-    // Allocate pbuf with required size
-    q = pbuf_alloc(PBUF_TRANSPORT, iphdr_len, PBUF_RAM);
+    // Wrap (or copy) the payload in a pbuf, p now belongs to it
+    q = ring_link_rx_pbuf_from_payload(p, iphdr_len);
     if (q == NULL) {
         ESP_LOGW(TAG, "Failed to allocate pbuf.");
         return ESP_FAIL;
     }
 
-    // Copy data to pbuf
-    memcpy(q->payload, p->buffer, iphdr_len);
-    q->next = NULL;
-    q->len = iphdr_len;
-    q->tot_len = iphdr_len;
-
     //ip4_debug_print(q);
 
     // Pass pbuf to esp_netif
@@ -134,41 +194,15 @@ static err_t output_function(struct netif *netif, struct pbuf *p, const ip4_addr
 static err_t linkoutput_function(struct netif *netif, struct pbuf *p)
 {
     // ESP_LOGI(TAG, "Calling linkoutput_function(struct netif *netif, struct pbuf *p)");
-
-    struct pbuf *q = p;
-    u16_t alloc_len = (u16_t)(p->tot_len);
-    ip4_debug_print(q);
+    ip4_debug_print(p);
     esp_netif_t *esp_netif = esp_netif_get_handle_from_netif_impl(netif);
-    esp_err_t ret = ESP_FAIL;
 
     if (!esp_netif) {
         LWIP_DEBUGF(NETIF_DEBUG, ("corresponding esp-netif is NULL: netif=%p pbuf=%p len=%d\n", netif, p, p->len));
         return ERR_IF;
     }
-    if (q->next == NULL) {
-        ret = esp_netif_transmit(esp_netif, q->payload, q->len);
-    } else {
-        // LWIP_DEBUGF(PBUF_DEBUG, ("low_level_output: pbuf is a list, application may has bug"));
-        ESP_LOGE(TAG, "low_level_output: pbuf is a list, application may has bug");
-        q = pbuf_alloc(PBUF_RAW_TX, p->tot_len, PBUF_RAM);
-        if (q != NULL) {
-            pbuf_copy(q, p);
-        } else {
-            return ERR_MEM;
-        }
-        ret = esp_netif_transmit(esp_netif, q->payload, q->len);
-        /* content in payload has been copied to DMA buffer, it's safe to free pbuf now */
-        pbuf_free(q);
-    }
-    /* Check error */
-    if (likely(ret == ESP_OK)) {
-        return ERR_OK;
-    }
-    if (ret == ESP_ERR_NO_MEM) {
-        return ERR_MEM;
-    }
-    return ERR_IF;
-
+    // El envio al anillo sigue en la tarea de TX de netif, fuera del hilo tcpip
+    return ring_link_netif_output(s_id_counter_rx++, p);
 }
 
 err_t ring_link_rx_netstack_lwip_init_fn(struct netif *netif)
@@ -181,6 +215,9 @@ err_t ring_link_rx_netstack_lwip_init_fn(struct netif *netif)
     netif->mtu = RING_LINK_NETIF_MTU;
     netif->hwaddr_len = ETH_HWADDR_LEN;
     netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+#ifdef CONFIG_RING_LINK_NETIF_CHECKSUM_OFFLOAD
+    NETIF_SET_CHECKSUM_CTRL(netif, RING_LINK_NETIF_CHECKSUM_FLAGS);
+#endif
     return ERR_OK;
 }
 
@@ -227,20 +264,7 @@ static esp_err_t esp_netif_ring_link_driver_transmit(void *h, void *buffer, size
         ESP_LOGI(TAG, "buffer is null");
         return ESP_OK;
     }
-    ring_link_payload_t p = {
-        .id = s_id_counter_rx++,
-        .ttl = RING_LINK_PAYLOAD_TTL,
-        .src_id = config_get_id(),
-        .dst_id = CONFIG_ID_ANY,
-        .buffer_type = RING_LINK_PAYLOAD_TYPE_ESP_NETIF,
-        .len = len,
-    };
-    if (len > RING_LINK_NETIF_MTU) {
-        ESP_LOGE(TAG, "Buffer length exceeds maximum allowed size.");
-        return ESP_ERR_INVALID_SIZE;
-    }
-    memcpy(p.buffer, buffer, len);
-    return ring_link_lowlevel_transmit_payload(&p);
+    return ring_link_netif_transmit(s_id_counter_rx++, buffer, len);
 }
 
 static esp_err_t ring_link_rx_driver_post_attach(esp_netif_t * esp_netif, void * args)
@@ -281,6 +305,17 @@ static void ring_link_rx_default_action_start(void *arg, esp_event_base_t base,
 esp_err_t ring_link_rx_netif_init(void)
 {
     ESP_LOGI(TAG, "Calling ring_link_rx_netif_init");
+
+    s_rx_loan_pool = xQueueCreate(RING_LINK_RX_NETIF_LOAN_MAX, sizeof(ring_link_rx_loan_t *));
+    if (s_rx_loan_pool == NULL) {
+        ESP_LOGE(TAG, "Failed to create pbuf loan pool");
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < RING_LINK_RX_NETIF_LOAN_MAX; i++) {
+        ring_link_rx_loan_t *loan = &s_rx_loans[i];
+        xQueueSend(s_rx_loan_pool, &loan, 0);
+    }
+
     ring_link_rx_netif = ring_link_netif_new(&netif_config);
 
     ESP_ERROR_CHECK(ring_link_netif_esp_netif_attach(ring_link_rx_netif, ring_link_rx_driver_post_attach));
@@ -55,40 +55,15 @@ static err_t output_function(struct netif *netif, struct pbuf *p, const ip4_addr
 static err_t linkoutput_function(struct netif *netif, struct pbuf *p)
 {
     // ESP_LOGI(TAG, "Calling linkoutput_function(struct netif *netif, struct pbuf *p)");
-
-    struct pbuf *q = p;
-    u16_t alloc_len = (u16_t)(p->tot_len);
-    // ip4_debug_print(q);
+    // ip4_debug_print(p);
     esp_netif_t *esp_netif = esp_netif_get_handle_from_netif_impl(netif);
-    esp_err_t ret = ESP_FAIL;
 
     if (!esp_netif) {
         LWIP_DEBUGF(NETIF_DEBUG, ("corresponding esp-netif is NULL: netif=%p pbuf=%p len=%d\n", netif, p, p->len));
         return ERR_IF;
     }
-    if (q->next == NULL) {
-        ret = esp_netif_transmit(esp_netif, q->payload, q->len);
-    } else {
-        ESP_LOGE(TAG, "low_level_output: pbuf is a list, application may has bug");
-        q = pbuf_alloc(PBUF_RAW_TX, p->tot_len, PBUF_RAM);
-        if (q != NULL) {
-            pbuf_copy(q, p);
-        } else {
-            return ERR_MEM;
-        }
-        ret = esp_netif_transmit(esp_netif, q->payload, q->len);
-        /* content in payload has been copied to DMA buffer, it's safe to free pbuf now */
-        pbuf_free(q);
-    }
-    /* Check error */
-    if (likely(ret == ESP_OK)) {
-        return ERR_OK;
-    }
-    if (ret == ESP_ERR_NO_MEM) {
-        return ERR_MEM;
-    }
-    return ERR_IF;
-
+    // El envio al anillo sigue en la tarea de TX de netif, fuera del hilo tcpip
+    return ring_link_netif_output(s_id_counter_tx++, p);
 }
 
 static esp_err_t esp_netif_ring_link_driver_transmit(void *h, void *buffer, size_t len)
@@ -101,22 +76,8 @@ static esp_err_t esp_netif_ring_link_driver_transmit(void *h, void *buffer, size
         ESP_LOGI(TAG, "buffer is null");
         return ESP_OK;
     }
-    ring_link_payload_t p = {
-        .id = s_id_counter_tx ++,
-        .ttl = RING_LINK_PAYLOAD_TTL,
-        .src_id = config_get_id(),
-        .dst_id = CONFIG_ID_ANY,
-        .buffer_type = RING_LINK_PAYLOAD_TYPE_ESP_NETIF,
-        .len = len,
-    };
-    if (len > RING_LINK_NETIF_MTU) {
-        ESP_LOGE(TAG, "Buffer length exceeds maximum allowed size.");
-        return ESP_ERR_INVALID_SIZE;
-    }
-    memcpy(p.buffer, buffer, len);
-    ESP_LOGD(TAG, "[%" PRIu32 "] Transmitting payload - id: %d, src: %d, dst: %d", 
-             packet_count, p.id, p.src_id, p.dst_id);
-    return ring_link_lowlevel_transmit_payload(&p);
+    ESP_LOGD(TAG, "[%" PRIu32 "] Transmitting payload - id: %d", packet_count, s_id_counter_tx);
+    return ring_link_netif_transmit(s_id_counter_tx++, buffer, len);
 }
 
 err_t ring_link_tx_netstack_init_fn(struct netif *netif)
@@ -129,6 +90,9 @@ err_t ring_link_tx_netstack_init_fn(struct netif *netif)
     netif->mtu = RING_LINK_NETIF_MTU;
     netif->hwaddr_len = ETH_HWADDR_LEN;
     netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+#ifdef CONFIG_RING_LINK_NETIF_CHECKSUM_OFFLOAD
+    NETIF_SET_CHECKSUM_CTRL(netif, RING_LINK_NETIF_CHECKSUM_FLAGS);
+#endif
     return ERR_OK;
 }
 
@@ -0,0 +1,78 @@
+#pragma once
+
+// C libraries
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_LINK_BUFFER_SIZE ((CONFIG_SIM_LINK_BUFFER_SIZE + 3) & ~3)  // word aligned, like SPI_BUFFER_SIZE
+#define SIM_LINK_RX_BUFFERS CONFIG_SIM_LINK_RX_BUFFERS
+#define SIM_LINK_TX_BUFFERS CONFIG_SIM_LINK_TX_BUFFERS
+#define SIM_LINK_TX_TIMEOUT_MS 100
+
+// Run time settings, read from the environment at init
+#define SIM_LINK_ENV_BOARD          "I4A_SIM_BOARD"           // position of this board, 0..boards-1 (required)
+#define SIM_LINK_ENV_BOARDS         "I4A_SIM_BOARDS"          // boards in the ring (required)
+#define SIM_LINK_ENV_DIR            "I4A_SIM_DIR"
+#define SIM_LINK_ENV_BANDWIDTH_KBPS "I4A_SIM_BANDWIDTH_KBPS"
+#define SIM_LINK_ENV_LATENCY_US     "I4A_SIM_LATENCY_US"
+#define SIM_LINK_ENV_LOSS_PERMILLE  "I4A_SIM_LOSS_PERMILLE"
+#define SIM_LINK_ENV_CLEAN_CLOCK_KHZ "I4A_SIM_CLEAN_CLOCK_KHZ"
+#define SIM_LINK_ENV_OVERCLOCK_LOSS  "I4A_SIM_OVERCLOCK_LOSS_PERMILLE"
+
+/**
+ * @brief Simulated ring link between Linux processes.
+ *
+ * Each board is a process with a UNIX datagram socket; board N sends to board
+ * N+1, like the SPI master of one board feeds the slave of the next. The
+ * sending side models the link: frames are clocked out at the configured
+ * bandwidth, some are dropped, and the receiver holds each one until its
+ * latency has elapsed. Same primitives as the SPI driver.
+ */
+esp_err_t sim_link_init(QueueHandle_t **rx_queues);
+esp_err_t sim_link_transmit(void *p, size_t len);
+esp_err_t sim_link_free_rx_buffer(void *p);
+bool sim_link_is_rx_buffer(const void *p);
+void *sim_link_alloc_tx_buffer(TickType_t ticks);
+esp_err_t sim_link_free_tx_buffer(void *p);
+bool sim_link_is_tx_buffer(const void *p);
+size_t sim_link_get_free_rx_count(void);
+
+void sim_link_set_rx_task(TaskHandle_t task);
+
+size_t sim_link_get_rx_drop_count(int rx_class);
+
+/**
+ * @brief Link clocks the rate adaptation may pick, slowest first.
+ */
+size_t sim_link_get_rates(const int **rates);
+
+/**
+ * @brief Sets the simulated link clock.
+ *
+ * Frames are then clocked out at `hz` bits per second, replacing the
+ * configured bandwidth. Above the clean clock of the link, frames arrive
+ * damaged with the overclock loss, and the receiver counts them as errors,
+ * like the SPI slave does with a clock it cannot follow.
+ */
+esp_err_t sim_link_set_clock(int hz);
+
+/**
+ * @brief Frames dropped on reception (truncated) since start-up.
+ */
+size_t sim_link_get_rx_error_count(void);
+
+#ifdef __cplusplus
+}
+#endif
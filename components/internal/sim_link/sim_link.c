@@ -0,0 +1,352 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "sim_link.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "task_config.h"
+
+#include "ring_link_payload.h"
+
+
+static const char* TAG = "==> SIM_LINK";
+
+#define NUM_BUFFERS  SIM_LINK_RX_BUFFERS
+
+typedef struct {
+    ring_link_payload_t *buffer;
+    size_t len;
+} sim_link_trans_t;
+
+static ring_link_payload_t buffer_pool[NUM_BUFFERS] __attribute__((aligned(4)));  // Buffers preasignados
+static QueueHandle_t free_buf_queue = NULL;       // Buffers libres
+static QueueHandle_t sim_rx_queues[RING_LINK_RX_CLASSES];  // Mensajes recibidos, una cola por clase
+static TaskHandle_t rx_task = NULL;               // Se notifica con cada mensaje recibido
+static portMUX_TYPE rx_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t rx_held = 0;                        // Buffers entregados a las capas superiores
+static size_t rx_errors = 0;                      // Datagramas truncados descartados
+static size_t rx_dropped[RING_LINK_RX_CLASSES];   // Descartados por cola llena
+
+static ring_link_payload_t tx_pool[SIM_LINK_TX_BUFFERS] __attribute__((aligned(4)));  // Buffers de transmision
+static sim_link_trans_t tx_trans[SIM_LINK_TX_BUFFERS];
+static QueueHandle_t free_tx_queue = NULL;        // Transacciones de TX libres
+static QueueHandle_t tx_pending_queue = NULL;     // Transacciones esperando el enlace
+
+static int s_rx_sock = -1;
+static int s_tx_sock = -1;
+static struct sockaddr_un s_next_addr;            // Socket de la placa siguiente del anillo
+
+static uint32_t s_bandwidth_kbps = CONFIG_SIM_LINK_BANDWIDTH_KBPS;
+static uint32_t s_latency_us = CONFIG_SIM_LINK_LATENCY_US;
+static uint32_t s_loss_permille = CONFIG_SIM_LINK_LOSS_PERMILLE;
+static uint32_t s_clean_clock_khz = CONFIG_SIM_LINK_CLEAN_CLOCK_KHZ;
+static uint32_t s_overclock_loss_permille = CONFIG_SIM_LINK_OVERCLOCK_LOSS_PERMILLE;
+static uint32_t s_clock_khz = 0;                  // Reloj del entrenamiento, 0 hasta el primer sim_link_set_clock
+static unsigned int s_loss_seed;
+
+// Mismos escalones que el reloj del master SPI
+static const int sim_rates[] = {
+    8000000, 9000000, 10000000, 11000000, 13000000, 16000000, 20000000, 26000000, 40000000, 80000000,
+};
+
+static int64_t sim_link_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Duerme hasta `when`; lo que sobra de un tick se compensa en los frames siguientes
+static void sim_link_sleep_until(int64_t when) {
+    int64_t ahead = when - sim_link_now_us();
+    TickType_t ticks = (TickType_t)(ahead / (portTICK_PERIOD_MS * 1000));
+    if (ahead > 0 && ticks > 0) {
+        vTaskDelay(ticks);
+    }
+}
+
+static uint32_t sim_link_env(const char *name, uint32_t fallback) {
+    const char *value = getenv(name);
+    return value != NULL ? (uint32_t)strtoul(value, NULL, 10) : fallback;
+}
+
+static void sim_link_socket_path(struct sockaddr_un *addr, const char *dir, uint32_t board) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/board%u.sock", dir, (unsigned)board);
+}
+
+// Recibe de la placa anterior. Cada datagrama lleva delante el instante en que
+// termina de llegar; se retiene hasta entonces para simular la latencia.
+static void sim_link_rx_task(void *pvParameters) {
+    ring_link_payload_t *payload;
+    int64_t due;
+
+    while (1) {
+        if (xQueueReceive(free_buf_queue, &payload, portMAX_DELAY) != pdTRUE) continue;
+
+        struct iovec iov[2] = {
+            { .iov_base = &due, .iov_len = sizeof(due) },
+            { .iov_base = payload, .iov_len = SIM_LINK_BUFFER_SIZE },
+        };
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+        ssize_t n;
+        // Bloquea hasta el proximo datagrama; las señales del planificador lo interrumpen
+        do {
+            n = recvmsg(s_rx_sock, &msg, 0);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            ESP_LOGE(TAG, "recvmsg failed (%s)", strerror(errno));
+            xQueueSend(free_buf_queue, &payload, 0);
+            continue;
+        }
+        size_t received = n > (ssize_t)sizeof(due) ? (size_t)n - sizeof(due) : 0;
+
+        // Mismo criterio que el slave SPI: descartar transferencias truncadas
+        if (received < RING_LINK_PAYLOAD_WIRE_LEN(0, 0) || payload->len > RING_LINK_PAYLOAD_DATA_MAX
+            || payload->credit_count > RING_LINK_CREDIT_MAX_NODES
+            || received < RING_LINK_PAYLOAD_WIRE_LEN(payload->len, payload->credit_count)) {
+            portENTER_CRITICAL(&rx_lock);
+            rx_errors++;
+            portEXIT_CRITICAL(&rx_lock);
+            xQueueSend(free_buf_queue, &payload, 0);
+            continue;
+        }
+
+        sim_link_sleep_until(due);
+        ring_link_rx_class_t cls = ring_link_payload_rx_class(payload);
+        if (xQueueSend(sim_rx_queues[cls], &payload, 0) != pdTRUE) {
+            // Cola llena, descartar el mensaje (¡devolver buffer!)
+            xQueueSend(free_buf_queue, &payload, 0);
+            portENTER_CRITICAL(&rx_lock);
+            rx_dropped[cls]++;
+            portEXIT_CRITICAL(&rx_lock);
+            continue;
+        }
+        portENTER_CRITICAL(&rx_lock);
+        rx_held++;
+        portEXIT_CRITICAL(&rx_lock);
+        if (rx_task != NULL) {
+            xTaskNotifyGive(rx_task);
+        }
+    }
+}
+
+// Hace de master: saca los frames al ritmo del ancho de banda configurado. El
+// buffer vuelve al pool cuando el frame termino de salir, como en el DMA.
+static void sim_link_tx_task(void *pvParameters) {
+    sim_link_trans_t *t;
+    int64_t link_free = 0;
+
+    while (1) {
+        if (xQueueReceive(tx_pending_queue, &t, portMAX_DELAY) != pdTRUE) continue;
+
+        int64_t now = sim_link_now_us();
+        int64_t start = link_free > now ? link_free : now;
+        int64_t wire_us = s_bandwidth_kbps > 0 ? (int64_t)t->len * 8 * 1000 / s_bandwidth_kbps : 0;
+        link_free = start + wire_us;
+        sim_link_sleep_until(link_free);
+
+        if ((uint32_t)(rand_r(&s_loss_seed) % 1000) >= s_loss_permille) {
+            int64_t due = link_free + s_latency_us;
+            // Con un reloj mas rapido de lo que el enlace soporta el frame llega
+            // roto: se manda truncado y el receptor lo cuenta como error
+            bool damaged = s_clean_clock_khz > 0 && s_clock_khz > s_clean_clock_khz
+                           && (uint32_t)(rand_r(&s_loss_seed) % 1000) < s_overclock_loss_permille;
+            struct iovec iov[2] = {
+                { .iov_base = &due, .iov_len = sizeof(due) },
+                { .iov_base = t->buffer, .iov_len = damaged ? t->len / 2 : t->len },
+            };
+            struct msghdr msg = {
+                .msg_name = &s_next_addr,
+                .msg_namelen = sizeof(s_next_addr),
+                .msg_iov = iov,
+                .msg_iovlen = 2,
+            };
+            // Si la placa siguiente no esta corriendo el frame se pierde, como en el bus
+            if (sendmsg(s_tx_sock, &msg, MSG_DONTWAIT) < 0) {
+                ESP_LOGD(TAG, "sendmsg failed (%s)", strerror(errno));
+            }
+        }
+        xQueueSend(free_tx_queue, &t, 0);
+    }
+}
+
+esp_err_t sim_link_init(QueueHandle_t **rx_queues) {
+    uint32_t board = sim_link_env(SIM_LINK_ENV_BOARD, UINT32_MAX);
+    uint32_t boards = sim_link_env(SIM_LINK_ENV_BOARDS, 0);
+    const char *dir = getenv(SIM_LINK_ENV_DIR);
+    if (dir == NULL) {
+        dir = CONFIG_SIM_LINK_SOCKET_DIR;
+    }
+    if (boards < 2 || board >= boards) {
+        ESP_LOGE(TAG, "Set %s (0..%s-1) and %s (2 or more) for each board",
+                 SIM_LINK_ENV_BOARD, SIM_LINK_ENV_BOARDS, SIM_LINK_ENV_BOARDS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_bandwidth_kbps = sim_link_env(SIM_LINK_ENV_BANDWIDTH_KBPS, s_bandwidth_kbps);
+    s_latency_us = sim_link_env(SIM_LINK_ENV_LATENCY_US, s_latency_us);
+    s_loss_permille = sim_link_env(SIM_LINK_ENV_LOSS_PERMILLE, s_loss_permille);
+    s_clean_clock_khz = sim_link_env(SIM_LINK_ENV_CLEAN_CLOCK_KHZ, s_clean_clock_khz);
+    s_overclock_loss_permille = sim_link_env(SIM_LINK_ENV_OVERCLOCK_LOSS, s_overclock_loss_permille);
+    s_loss_seed = board + 1;
+
+    // Sockets: se recibe en el propio, se envia al de la placa siguiente
+    struct sockaddr_un own_addr;
+    sim_link_socket_path(&own_addr, dir, board);
+    sim_link_socket_path(&s_next_addr, dir, (board + 1) % boards);
+    mkdir(dir, 0777);
+    unlink(own_addr.sun_path);
+    s_rx_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    s_tx_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (s_rx_sock < 0 || s_tx_sock < 0
+        || bind(s_rx_sock, (struct sockaddr *)&own_addr, sizeof(own_addr)) != 0) {
+        ESP_LOGE(TAG, "Failed to open %s (%s)", own_addr.sun_path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    // inicializo punteros a queues
+    free_buf_queue = xQueueCreate(NUM_BUFFERS, sizeof(ring_link_payload_t *));
+    for (int i = 0; i < RING_LINK_RX_CLASSES; i++) {
+        sim_rx_queues[i] = xQueueCreate(NUM_BUFFERS, sizeof(ring_link_payload_t *));
+        if (sim_rx_queues[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to create queue");
+            return ESP_FAIL;
+        }
+    }
+    free_tx_queue = xQueueCreate(SIM_LINK_TX_BUFFERS, sizeof(sim_link_trans_t *));
+    tx_pending_queue = xQueueCreate(SIM_LINK_TX_BUFFERS, sizeof(sim_link_trans_t *));
+    if (free_buf_queue == NULL || free_tx_queue == NULL || tx_pending_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create queue");
+        return ESP_FAIL;
+    }
+    *rx_queues = sim_rx_queues;
+
+    // Inicializar pool de buffers
+    for (int i = 0; i < NUM_BUFFERS; i++) {
+        ring_link_payload_t *ptr = &buffer_pool[i];
+        xQueueSend(free_buf_queue, &ptr, 0);
+    }
+    for (int i = 0; i < SIM_LINK_TX_BUFFERS; i++) {
+        sim_link_trans_t *t = &tx_trans[i];
+        t->buffer = &tx_pool[i];
+        xQueueSend(free_tx_queue, &t, 0);
+    }
+
+    xTaskCreatePinnedToCore(sim_link_rx_task, "sim_link_rx", TASK_SIM_LINK_STACK, NULL, TASK_SIM_LINK_PRIORITY, NULL, TASK_SIM_LINK_CORE);
+    xTaskCreatePinnedToCore(sim_link_tx_task, "sim_link_tx", TASK_SIM_LINK_STACK, NULL, TASK_SIM_LINK_PRIORITY, NULL, TASK_SIM_LINK_CORE);
+
+    ESP_LOGI(TAG, "Board %u of %u: %u kbit/s, %u us, %u/1000 lost",
+             (unsigned)board, (unsigned)boards, (unsigned)s_bandwidth_kbps,
+             (unsigned)s_latency_us, (unsigned)s_loss_permille);
+    return ESP_OK;
+}
+
+// Transaccion asociada a un buffer del pool de TX, NULL si p no es del pool
+static sim_link_trans_t *sim_link_trans_of(const void *p) {
+    const ring_link_payload_t *payload = (const ring_link_payload_t *)p;
+    if (payload < tx_pool || payload >= tx_pool + SIM_LINK_TX_BUFFERS) {
+        return NULL;
+    }
+    return &tx_trans[payload - tx_pool];
+}
+
+size_t sim_link_get_rates(const int **rates) {
+    *rates = sim_rates;
+    return sizeof(sim_rates) / sizeof(sim_rates[0]);
+}
+
+esp_err_t sim_link_set_clock(int hz) {
+    s_clock_khz = (uint32_t)hz / 1000;
+    s_bandwidth_kbps = s_clock_khz;
+    ESP_LOGI(TAG, "Link clock set to %u kHz", (unsigned)s_clock_khz);
+    return ESP_OK;
+}
+
+void *sim_link_alloc_tx_buffer(TickType_t ticks) {
+    sim_link_trans_t *t;
+    return xQueueReceive(free_tx_queue, &t, ticks) == pdTRUE ? t->buffer : NULL;
+}
+
+bool sim_link_is_tx_buffer(const void *p) {
+    return sim_link_trans_of(p) != NULL;
+}
+
+esp_err_t sim_link_free_tx_buffer(void *p) {
+    sim_link_trans_t *t = sim_link_trans_of(p);
+    if (t == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xQueueSend(free_tx_queue, &t, 0);
+    return ESP_OK;
+}
+
+esp_err_t sim_link_transmit(void *p, size_t len) {
+    if (len > sizeof(ring_link_payload_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Si p ya es un buffer del pool se transmite sin copiar
+    sim_link_trans_t *t = sim_link_trans_of(p);
+    if (t == NULL) {
+        if (xQueueReceive(free_tx_queue, &t, pdMS_TO_TICKS(SIM_LINK_TX_TIMEOUT_MS)) != pdTRUE) {
+            ESP_LOGW(TAG, "No TX buffer available");
+            return ESP_ERR_TIMEOUT;
+        }
+        memcpy(t->buffer, p, len);
+    }
+    t->len = len;
+
+    // La cola tiene lugar para todos los buffers: nunca bloquea
+    xQueueSend(tx_pending_queue, &t, portMAX_DELAY);
+    return ESP_OK;
+}
+
+bool sim_link_is_rx_buffer(const void *p) {
+    const ring_link_payload_t *payload = (const ring_link_payload_t *)p;
+    return payload >= buffer_pool && payload < buffer_pool + NUM_BUFFERS;
+}
+
+esp_err_t sim_link_free_rx_buffer(void *p)
+{
+    portENTER_CRITICAL(&rx_lock);
+    rx_held--;
+    portEXIT_CRITICAL(&rx_lock);
+    xQueueSend(free_buf_queue, &p, 0);
+    return ESP_OK;
+}
+
+size_t sim_link_get_free_rx_count(void)
+{
+    portENTER_CRITICAL(&rx_lock);
+    size_t held = rx_held;
+    portEXIT_CRITICAL(&rx_lock);
+    return NUM_BUFFERS - held;
+}
+
+void sim_link_set_rx_task(TaskHandle_t task)
+{
+    rx_task = task;
+}
+
+size_t sim_link_get_rx_drop_count(int rx_class)
+{
+    portENTER_CRITICAL(&rx_lock);
+    size_t dropped = rx_dropped[rx_class];
+    portEXIT_CRITICAL(&rx_lock);
+    return dropped;
+}
+
+size_t sim_link_get_rx_error_count(void)
+{
+    portENTER_CRITICAL(&rx_lock);
+    size_t errors = rx_errors;
+    portEXIT_CRITICAL(&rx_lock);
+    return errors;
+}
@@ -3,19 +3,26 @@
 // C libraries
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 // ESP32 libraries
 #include "driver/spi_master.h"
 #include "driver/spi_slave.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define SPI_BUFFER_SIZE CONFIG_SPI_BUFFER_SIZE
+#define SPI_BUFFER_SIZE ((CONFIG_SPI_BUFFER_SIZE + 3) & ~3)  // DMA y payload trabajan por palabras
 #define SPI_QUEUE_SIZE 40
+#define SPI_RX_BUFFERS CONFIG_SPI_RX_BUFFERS
+#define SPI_TX_BUFFERS CONFIG_SPI_TX_BUFFERS
+#define SPI_TX_TIMEOUT_MS 100
+#define SPI_RATE_MAX (CONFIG_SPI_RATE_MAX_MHZ * 1000 * 1000)
 
 #define SPI_SENDER_GPIO_MOSI 23
 #define SPI_SENDER_GPIO_SCLK 18
@@ -50,9 +57,46 @@ extern "C" {
 #define SPI_FREQ SPI_MASTER_FREQ_80M
 #endif
 
-esp_err_t spi_init(QueueHandle_t **rx_queue);
+/**
+ * @brief Starts the SPI link.
+ *
+ * @param[out] rx_queues Set to the received-frame queues, one per ring_link_rx_class_t.
+ */
+esp_err_t spi_init(QueueHandle_t **rx_queues);
 esp_err_t spi_transmit(void *p, size_t len);
 esp_err_t spi_free_rx_buffer(void *p);
+bool spi_is_rx_buffer(const void *p);
+void *spi_alloc_tx_buffer(TickType_t ticks);
+esp_err_t spi_free_tx_buffer(void *p);
+bool spi_is_tx_buffer(const void *p);
+size_t spi_get_free_rx_count(void);
+
+/**
+ * @brief Changes the SPI master clock, waiting for the transfers in flight.
+ *
+ * Must be called from the task that queues the transfers.
+ */
+esp_err_t spi_set_clock(int hz);
+
+/**
+ * @brief Clock rates the master may use, slowest first, up to SPI_RATE_MAX.
+ */
+size_t spi_get_rates(const int **rates);
+
+/**
+ * @brief Sets the task notified each time a frame is queued for it.
+ */
+void spi_set_rx_task(TaskHandle_t task);
+
+/**
+ * @brief Frames of a ring_link_rx_class_t dropped because its RX queue was full.
+ */
+size_t spi_get_rx_drop_count(int rx_class);
+
+/**
+ * @brief Truncated transfers dropped by the slave since boot.
+ */
+size_t spi_get_rx_error_count(void);
 
 
 #ifdef __cplusplus
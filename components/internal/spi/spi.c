@@ -1,6 +1,9 @@
+#include <string.h>
+
 #include "spi.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "task_config.h"
 
 #include "ring_link_payload.h"
@@ -9,12 +12,57 @@
 static spi_device_handle_t s_spi_device_handle = {0};
 static const char* TAG = "==> SPI";
 
-#define NUM_BUFFERS  8
+#define NUM_BUFFERS  SPI_RX_BUFFERS
 
 DMA_ATTR static ring_link_payload_t buffer_pool[NUM_BUFFERS] __attribute__((aligned(4)));  // Buffers preasignados
 static QueueHandle_t free_buf_queue = NULL;       // Buffers libres
-static QueueHandle_t spi_rx_queue = NULL;         // Mensajes recibidos
+static QueueHandle_t spi_rx_queues[RING_LINK_RX_CLASSES];  // Mensajes recibidos, una cola por clase
+static TaskHandle_t rx_task = NULL;               // Se notifica con cada mensaje recibido
+static spi_slave_transaction_t rx_trans[NUM_BUFFERS];  // Una transaccion por buffer armado
+static portMUX_TYPE rx_held_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t rx_held = 0;                        // Buffers entregados a las capas superiores
+
+DMA_ATTR static ring_link_payload_t tx_pool[SPI_TX_BUFFERS] __attribute__((aligned(4)));  // Buffers de transmision
+static spi_transaction_t tx_trans[SPI_TX_BUFFERS];
+static QueueHandle_t free_tx_queue = NULL;        // Transacciones de TX libres
+static SemaphoreHandle_t tx_device_mutex = NULL;  // Protege el dispositivo mientras cambia el reloj
+static SemaphoreHandle_t tx_idle = NULL;          // Se da cuando termina la ultima transaccion en vuelo
+static portMUX_TYPE tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t tx_in_flight = 0;                   // Transacciones encoladas en el driver, bajo tx_lock
+static size_t rx_errors = 0;                      // Transferencias truncadas descartadas
+static size_t rx_dropped[RING_LINK_RX_CLASSES];   // Descartadas por cola llena
+
+// Frecuencias que prueba el entrenamiento del enlace, de menor a mayor
+static const int spi_rates[] = {
+    SPI_MASTER_FREQ_8M, SPI_MASTER_FREQ_9M, SPI_MASTER_FREQ_10M, SPI_MASTER_FREQ_11M,
+    SPI_MASTER_FREQ_13M, SPI_MASTER_FREQ_16M, SPI_MASTER_FREQ_20M, SPI_MASTER_FREQ_26M,
+    SPI_MASTER_FREQ_40M, SPI_MASTER_FREQ_80M,
+};
+
+static void spi_tx_done_cb(spi_transaction_t *t);
+
+//Configuration for the SPI device on the other side of the bus
+static spi_device_interface_config_t devcfg={
+    .command_bits=0,
+    .address_bits=0,
+    .dummy_bits=0,
+    .clock_speed_hz=SPI_FREQ,
+    .duty_cycle_pos=128,        //50% duty cycle
+    .mode=0,
+    .spics_io_num=SPI_SENDER_GPIO_CS,
+    .cs_ena_pretrans = 3,   
+    .cs_ena_posttrans = 10,        //Keep the CS low 3 cycles after transaction, to stop slave from missing the last bit when CS has less propagation delay than CLK
+    .queue_size=SPI_QUEUE_SIZE,
+#ifdef SPI_DEVICE_NO_RETURN_RESULT
+    .flags=SPI_DEVICE_NO_RETURN_RESULT,
+#endif
+    .post_cb=spi_tx_done_cb     // Los buffers vuelven al pool desde aca
+};
 
+// Mantiene la cola del slave cargada: cada buffer libre se arma con su propia
+// transaccion, asi una transferencia del master nunca encuentra el slave sin
+// buffer. Los buffers vuelven a free_buf_queue desde spi_post_trans_cb (descarte)
+// o desde spi_free_rx_buffer, y esta tarea los vuelve a armar.
 static void spi_polling_task(void *pvParameters) {
     ring_link_payload_t *payload;
 
@@ -22,28 +70,58 @@ static void spi_polling_task(void *pvParameters) {
         // Esperar un buffer libre del pool
         if (xQueueReceive(free_buf_queue, &payload, portMAX_DELAY) != pdTRUE) continue;
 
-        spi_slave_transaction_t t = { 0 };
-        t.length = SPI_BUFFER_SIZE * 8;
-        t.rx_buffer = payload;
+#ifndef SPI_SLAVE_NO_RETURN_RESULT
+        // Sin el flag el driver tambien encola los resultados: se vacian, ya
+        // se entregaron en spi_post_trans_cb
+        spi_slave_transaction_t *done;
+        while (spi_slave_get_trans_result(SPI_RECEIVER_HOST, &done, 0) == ESP_OK) {
+        }
+#endif
+        spi_slave_transaction_t *t = &rx_trans[payload - buffer_pool];
+        t->length = SPI_BUFFER_SIZE * 8;
+        t->rx_buffer = payload;
 
-        esp_err_t ret = spi_slave_transmit(SPI_RECEIVER_HOST, &t, portMAX_DELAY);
+        esp_err_t ret = spi_slave_queue_trans(SPI_RECEIVER_HOST, t, portMAX_DELAY);
         if (ret != ESP_OK) {
             // Si hubo error, devolver el buffer al pool
             ESP_LOGE(TAG, "Failed to spi_slave_queue_trans");
             xQueueSend(free_buf_queue, &payload, 0);
+            vTaskDelay(1);
         }
-        taskYIELD();
     }
 }
 
 void IRAM_ATTR spi_post_trans_cb(spi_slave_transaction_t *trans) {
     ring_link_payload_t *payload = (ring_link_payload_t *) trans->rx_buffer;
+    size_t received = trans->trans_len / 8;
 
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    if (xQueueSendFromISR(spi_rx_queue, &payload, &xHigherPriorityTaskWoken) != pdTRUE) {
-        // Cola llena, descartar el mensaje (¡devolver buffer!)
+    // El master solo envia header + len + CRC + registros: descartar transferencias truncadas
+    if (received < RING_LINK_PAYLOAD_WIRE_LEN(0, 0) || payload->len > RING_LINK_PAYLOAD_DATA_MAX
+        || payload->credit_count > RING_LINK_CREDIT_MAX_NODES
+        || received < RING_LINK_PAYLOAD_WIRE_LEN(payload->len, payload->credit_count)) {
+        portENTER_CRITICAL_ISR(&rx_held_lock);
+        rx_errors++;
+        portEXIT_CRITICAL_ISR(&rx_held_lock);
         xQueueSendFromISR(free_buf_queue, &payload, &xHigherPriorityTaskWoken);
+    } else {
+        // Se clasifica al completar: un consumidor lento no frena a la otra clase
+        ring_link_rx_class_t cls = ring_link_payload_rx_class(payload);
+        if (xQueueSendFromISR(spi_rx_queues[cls], &payload, &xHigherPriorityTaskWoken) != pdTRUE) {
+            // Cola llena, descartar el mensaje (¡devolver buffer!)
+            xQueueSendFromISR(free_buf_queue, &payload, &xHigherPriorityTaskWoken);
+            portENTER_CRITICAL_ISR(&rx_held_lock);
+            rx_dropped[cls]++;
+            portEXIT_CRITICAL_ISR(&rx_held_lock);
+        } else {
+            portENTER_CRITICAL_ISR(&rx_held_lock);
+            rx_held++;
+            portEXIT_CRITICAL_ISR(&rx_held_lock);
+            if (rx_task != NULL) {
+                vTaskNotifyGiveFromISR(rx_task, &xHigherPriorityTaskWoken);
+            }
+        }
     }
 
     if (xHigherPriorityTaskWoken) portYIELD_FROM_ISR();
@@ -64,7 +142,9 @@ static esp_err_t spi_rx_init() {
         .mode=0,
         .spics_io_num=SPI_RECEIVER_GPIO_CS,
         .queue_size=SPI_QUEUE_SIZE,
-        .flags=0,
+#ifdef SPI_SLAVE_NO_RETURN_RESULT
+        .flags=SPI_SLAVE_NO_RETURN_RESULT,  // Los resultados se entregan en spi_post_trans_cb
+#endif
         //.post_setup_cb=spi_post_setup_cb,
         .post_trans_cb=spi_post_trans_cb
     };
@@ -84,45 +164,45 @@ static esp_err_t spi_tx_init() {
         .quadhd_io_num=-1
     };
 
-    //Configuration for the SPI device on the other side of the bus
-    spi_device_interface_config_t devcfg={
-        .command_bits=0,
-        .address_bits=0,
-        .dummy_bits=0,
-        .clock_speed_hz=SPI_FREQ,
-        .duty_cycle_pos=128,        //50% duty cycle
-        .mode=0,
-        .spics_io_num=SPI_SENDER_GPIO_CS,
-        .cs_ena_pretrans = 3,   
-        .cs_ena_posttrans = 10,        //Keep the CS low 3 cycles after transaction, to stop slave from missing the last bit when CS has less propagation delay than CLK
-        .queue_size=SPI_QUEUE_SIZE
-    };
-
     //Initialize the SPI bus and add the device we want to send stuff to.
     ESP_ERROR_CHECK(spi_bus_initialize(SPI_SENDER_HOST, &buscfg, SPI_DMA_CH_AUTO));
     ESP_ERROR_CHECK(spi_bus_add_device(SPI_SENDER_HOST, &devcfg, &s_spi_device_handle));
     return ESP_OK;
 }
 
-esp_err_t spi_init(QueueHandle_t **rx_queue) {
+esp_err_t spi_init(QueueHandle_t **rx_queues) {
 
     ESP_ERROR_CHECK(spi_rx_init());
     ESP_ERROR_CHECK(spi_tx_init());
 
     // inicializo punteros a queues
     free_buf_queue = xQueueCreate(NUM_BUFFERS, sizeof(ring_link_payload_t *));
-    spi_rx_queue = xQueueCreate(NUM_BUFFERS, sizeof(ring_link_payload_t *));
-    if (free_buf_queue == NULL || spi_rx_queue == NULL) {
+    for (int i = 0; i < RING_LINK_RX_CLASSES; i++) {
+        spi_rx_queues[i] = xQueueCreate(NUM_BUFFERS, sizeof(ring_link_payload_t *));
+        if (spi_rx_queues[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to create queue");
+            return ESP_FAIL;
+        }
+    }
+    free_tx_queue = xQueueCreate(SPI_TX_BUFFERS, sizeof(spi_transaction_t *));
+    tx_device_mutex = xSemaphoreCreateMutex();
+    tx_idle = xSemaphoreCreateBinary();
+    if (free_buf_queue == NULL || free_tx_queue == NULL || tx_device_mutex == NULL || tx_idle == NULL) {
         ESP_LOGE(TAG, "Failed to create queue");
         return ESP_FAIL;
     }
-    *rx_queue = &spi_rx_queue;
+    *rx_queues = spi_rx_queues;
 
     // Inicializar pool de buffers
     for (int i = 0; i < NUM_BUFFERS; i++) {
         ring_link_payload_t *ptr = &buffer_pool[i];
         xQueueSend(free_buf_queue, &ptr, 0);
     }
+    for (int i = 0; i < SPI_TX_BUFFERS; i++) {
+        spi_transaction_t *t = &tx_trans[i];
+        t->tx_buffer = &tx_pool[i];
+        xQueueSend(free_tx_queue, &t, 0);
+    }
     // inicializo tarea de polling
     xTaskCreatePinnedToCore(spi_polling_task, "spi_polling_task", TASK_SPI_STACK, NULL, TASK_SPI_PRIORITY, NULL, TASK_SPI_CORE);
 
@@ -130,20 +210,182 @@ esp_err_t spi_init(QueueHandle_t **rx_queue) {
 }
 
 
+// Fin de una transferencia del master (ISR): el buffer vuelve directo al pool
+static void IRAM_ATTR spi_tx_done_cb(spi_transaction_t *t) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    portENTER_CRITICAL_ISR(&tx_lock);
+    bool idle = --tx_in_flight == 0;
+    portEXIT_CRITICAL_ISR(&tx_lock);
+
+    xQueueSendFromISR(free_tx_queue, &t, &xHigherPriorityTaskWoken);
+    if (idle) {
+        xSemaphoreGiveFromISR(tx_idle, &xHigherPriorityTaskWoken);
+    }
+    if (xHigherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+// Los descriptores ya volvieron al pool en spi_tx_done_cb: la cola de resultados
+// del driver solo se vacia, para que spi_bus_remove_device la encuentre vacia.
+// Con tx_device_mutex tomado
+static void spi_tx_drop_results(TickType_t ticks) {
+#ifndef SPI_DEVICE_NO_RETURN_RESULT
+    spi_transaction_t *t;
+    while (spi_device_get_trans_result(s_spi_device_handle, &t, ticks) == ESP_OK) {
+    }
+#endif
+}
+
+// Espera un buffer libre hasta `ticks`, las transferencias terminadas alimentan la cola
+static spi_transaction_t *spi_tx_take(TickType_t ticks) {
+    spi_transaction_t *t;
+    return xQueueReceive(free_tx_queue, &t, ticks) == pdTRUE ? t : NULL;
+}
+
+// Transaccion asociada a un buffer del pool de TX, NULL si p no es del pool
+static spi_transaction_t *spi_tx_trans_of(const void *p) {
+    const ring_link_payload_t *payload = (const ring_link_payload_t *)p;
+    if (payload < tx_pool || payload >= tx_pool + SPI_TX_BUFFERS) {
+        return NULL;
+    }
+    return &tx_trans[payload - tx_pool];
+}
+
+void *spi_alloc_tx_buffer(TickType_t ticks) {
+    spi_transaction_t *t = spi_tx_take(ticks);
+    return t != NULL ? (void *)t->tx_buffer : NULL;
+}
+
+bool spi_is_tx_buffer(const void *p) {
+    return spi_tx_trans_of(p) != NULL;
+}
+
+esp_err_t spi_free_tx_buffer(void *p) {
+    spi_transaction_t *t = spi_tx_trans_of(p);
+    if (t == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xQueueSend(free_tx_queue, &t, 0);
+    return ESP_OK;
+}
+
 esp_err_t spi_transmit(void *p, size_t len) {
     ring_link_payload_t* payload = (ring_link_payload_t*)p;
     ESP_LOGD(TAG, "Pre-transmit payload - Type: 0x%02x, ID: %d, TTL: %d", 
              payload->buffer_type, payload->id, payload->ttl);
-             
-    spi_transaction_t t = {
-        .length = len * 8,
-        .tx_buffer = p,
-    };
-    return spi_device_transmit(s_spi_device_handle, &t);
+
+    if (len > sizeof(ring_link_payload_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Si p ya es un buffer del pool se transmite sin copiar
+    spi_transaction_t *t = spi_tx_trans_of(p);
+    if (t == NULL) {
+        t = spi_tx_take(pdMS_TO_TICKS(SPI_TX_TIMEOUT_MS));
+        if (t == NULL) {
+            ESP_LOGW(TAG, "No TX buffer available");
+            return ESP_ERR_TIMEOUT;
+        }
+        memcpy((void *)t->tx_buffer, p, len);
+    }
+    t->length = len * 8;
+
+    // La cola del driver tiene lugar para todos los buffers: nunca bloquea.
+    // Se cuenta antes de encolar, la transferencia puede terminar enseguida
+    xSemaphoreTake(tx_device_mutex, portMAX_DELAY);
+    spi_tx_drop_results(0);
+    portENTER_CRITICAL(&tx_lock);
+    tx_in_flight++;
+    portEXIT_CRITICAL(&tx_lock);
+    esp_err_t ret = spi_device_queue_trans(s_spi_device_handle, t, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        portENTER_CRITICAL(&tx_lock);
+        tx_in_flight--;
+        portEXIT_CRITICAL(&tx_lock);
+    }
+    xSemaphoreGive(tx_device_mutex);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to spi_device_queue_trans");
+        xQueueSend(free_tx_queue, &t, 0);
+    }
+    return ret;
+}
+
+esp_err_t spi_set_clock(int hz) {
+    // El dispositivo solo se puede quitar sin transferencias en vuelo. Con el
+    // mutex tomado no se encolan mas; se descarta un aviso viejo de tx_idle
+    xSemaphoreTake(tx_device_mutex, portMAX_DELAY);
+    xSemaphoreTake(tx_idle, 0);
+    portENTER_CRITICAL(&tx_lock);
+    bool busy = tx_in_flight > 0;
+    portEXIT_CRITICAL(&tx_lock);
+    if (busy) {
+        xSemaphoreTake(tx_idle, portMAX_DELAY);
+    }
+    // El ISR avisa antes de dejar el ultimo resultado: se le da un tick
+    spi_tx_drop_results(1);
+
+    esp_err_t ret = spi_bus_remove_device(s_spi_device_handle);
+    if (ret == ESP_OK) {
+        devcfg.clock_speed_hz = hz;
+        ret = spi_bus_add_device(SPI_SENDER_HOST, &devcfg, &s_spi_device_handle);
+    }
+    xSemaphoreGive(tx_device_mutex);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to change the SPI clock to %d kHz", hz / 1000);
+        return ret;
+    }
+    ESP_LOGI(TAG, "SPI clock set to %d kHz", hz / 1000);
+    return ESP_OK;
+}
+
+size_t spi_get_rates(const int **rates) {
+    size_t count = 0;
+    while (count < sizeof(spi_rates) / sizeof(spi_rates[0])
+           && spi_rates[count] <= SPI_RATE_MAX) {
+        count++;
+    }
+    *rates = spi_rates;
+    return count;
+}
+
+void spi_set_rx_task(TaskHandle_t task) {
+    rx_task = task;
+}
+
+size_t spi_get_rx_drop_count(int rx_class) {
+    portENTER_CRITICAL(&rx_held_lock);
+    size_t dropped = rx_dropped[rx_class];
+    portEXIT_CRITICAL(&rx_held_lock);
+    return dropped;
+}
+
+size_t spi_get_rx_error_count(void) {
+    portENTER_CRITICAL(&rx_held_lock);
+    size_t errors = rx_errors;
+    portEXIT_CRITICAL(&rx_held_lock);
+    return errors;
+}
+
+bool spi_is_rx_buffer(const void *p) {
+    const ring_link_payload_t *payload = (const ring_link_payload_t *)p;
+    return payload >= buffer_pool && payload < buffer_pool + NUM_BUFFERS;
 }
 
 esp_err_t spi_free_rx_buffer(void *p)
 {
+    portENTER_CRITICAL(&rx_held_lock);
+    rx_held--;
+    portEXIT_CRITICAL(&rx_held_lock);
     xQueueSend(free_buf_queue, &p, 0);
     return ESP_OK;
 }
+
+size_t spi_get_free_rx_count(void)
+{
+    portENTER_CRITICAL(&rx_held_lock);
+    size_t held = rx_held;
+    portEXIT_CRITICAL(&rx_held_lock);
+    return NUM_BUFFERS - held;
+}
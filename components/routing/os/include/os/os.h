@@ -7,6 +7,7 @@
 /**
  * OS provided abstractions:
  *  - Mutex
+ *  - Events
  *  - Timers
  *  - Queues
  */
@@ -25,6 +26,17 @@ void mutex_destroy(mutex_t *m);
         mutex_unlock(lock);    \
     } while (0);
 
+/**
+ * One-shot wake-up between tasks: event_wait blocks until event_signal is
+ * called. A signal given before the wait is not lost.
+ */
+typedef void *event_t;
+
+bool event_create(event_t *e);
+bool event_wait(event_t *e);
+bool event_signal(event_t *e);
+void event_destroy(event_t *e);
+
 /**
  * Called when the device encounters a condition that won't allow
  * it to continue operating.
@@ -35,6 +35,32 @@ void mutex_destroy(mutex_t *m)
     *m = NULL;
 }
 
+bool event_create(event_t *e)
+{
+    if (!e) return false;
+    *e = (event_t)xSemaphoreCreateBinary();
+    return (*e != NULL);
+}
+
+bool event_wait(event_t *e)
+{
+    if (!e || *e == NULL) return false;
+    return (xSemaphoreTake((SemaphoreHandle_t)(*e), portMAX_DELAY) == pdTRUE);
+}
+
+bool event_signal(event_t *e)
+{
+    if (!e || *e == NULL) return false;
+    return (xSemaphoreGive((SemaphoreHandle_t)(*e)) == pdTRUE);
+}
+
+void event_destroy(event_t *e)
+{
+    if (!e || *e == NULL) return;
+    vSemaphoreDelete((SemaphoreHandle_t)(*e));
+    *e = NULL;
+}
+
 void os_panic(const char *fmt, ...)
 {
     va_list args;
@@ -9,6 +9,7 @@ extern "C" {
 #include <stdint.h>
 
 #include "os/os.h"
+#include "routing_config/routing_config.h"
 #include "siblings/siblings.h"
 
 #define RS_MAX_BROADCAST_LEN 512
@@ -36,10 +37,25 @@ typedef struct ring_callback {
     void *context;
 } ring_callback_t;
 
+/**
+ * Send lanes. Each one has its own lock and buffer, so a component never
+ * waits for the message of a component in another lane. The lane is passed
+ * down to the ring layer, which sends control messages ahead of bulk ones.
+ */
+typedef enum rs_lane {
+    RS_LANE_CONTROL = 0,  // short coordination messages: sync tokens, managers
+    RS_LANE_BULK = 1,     // routing events, shared state and info refreshes
+    RS_LANES,
+} rs_lane_t;
+
+typedef struct ring_share_lane {
+    mutex_t lock;
+    uint8_t buffer[RS_MAX_BROADCAST_LEN + 1];
+} ring_share_lane_t;
+
 typedef struct ring_share {
     siblings_t *siblings;
-    mutex_t broadcast_lock;
-    uint8_t buffer[RS_MAX_BROADCAST_LEN + 1];
+    ring_share_lane_t lanes[RS_LANES];
     ring_callback_t components[RS_MAX_COMPONENTS];
 } ring_share_t;
 
@@ -49,6 +65,41 @@ void rs_register_component(ring_share_t *self, component_id_t component, ring_ca
 
 bool rs_broadcast(ring_share_t *self, component_id_t component, const void *msg, uint16_t len);
 
+/**
+ * Like rs_broadcast, for a message made of a header followed by a body.
+ *
+ * Both parts are copied straight into the lane buffer, so callers do not
+ * need to assemble the message first. The lane is held only until the ring
+ * layer has its own copy; waiting for the outcome does not block it.
+ */
+bool rs_broadcast_with_header(ring_share_t *self, component_id_t component, const void *header, uint16_t header_len,
+                              const void *msg, uint16_t len);
+
+typedef void (*ring_share_done_fn_t)(void *ctx, bool delivered);
+
+/**
+ * Like rs_broadcast, but returns as soon as the message is queued.
+ *
+ * Retries happen in the ring layer, which keeps the messages of a component
+ * in order: one is sent only once the previous one is delivered or given up.
+ * done, if given, gets the outcome and must not block. Returns false if the
+ * message could not be queued.
+ */
+bool rs_broadcast_async(ring_share_t *self, component_id_t component, const void *msg, uint16_t len,
+                        ring_share_done_fn_t done, void *ctx);
+
+/**
+ * Sends a message to the component on a single sibling device.
+ *
+ * The message stops at dst instead of travelling the whole ring, and
+ * returns as soon as it is queued. Passing done asks dst for a delivery
+ * ACK: the ring layer retries until it arrives and done gets the outcome.
+ * Without done the message is sent once. Returns false if the message
+ * could not be queued, or dst is this device.
+ */
+bool rs_send_to(ring_share_t *self, orientation_t dst, component_id_t component, const void *msg, uint16_t len,
+                ring_share_done_fn_t done, void *ctx);
+
 void rs_shutdown(ring_share_t *self);
 
 #ifdef __cplusplus
@@ -6,6 +6,13 @@
 #include "os/os.h"
 #include "siblings/siblings.h"
 
+#define TAG "ring_share"
+
+_Static_assert((int)RS_LANE_CONTROL == (int)SB_LANE_CONTROL && (int)RS_LANE_BULK == (int)SB_LANE_BULK,
+               "ring_share lanes must match the siblings ones");
+// Each component is its own stream, so its messages arrive in order
+_Static_assert(RS_MAX_COMPONENTS <= SB_MAX_STREAMS, "Not enough sibling streams for the components");
+
 static void on_sibling_message(void *context, const uint8_t *msg, uint16_t len) {
     ring_share_t *self = context;
 
@@ -26,12 +33,56 @@ static void on_sibling_message(void *context, const uint8_t *msg, uint16_t len)
         cb->callback(cb->context, msg + 1, len - 1);
 }
 
+static rs_lane_t lane_of(component_id_t component) {
+    switch (component) {
+        case RS_ROUTING:
+        case RS_SHARED_STATE:
+        case RS_INFO_MANAGER:
+            return RS_LANE_BULK;
+        default:
+            return RS_LANE_CONTROL;
+    }
+}
+
+// Leaves the lane locked, with the message of the component in its buffer
+static ring_share_lane_t *lane_begin(
+    ring_share_t *self, rs_lane_t id, component_id_t component, const void *header, uint16_t header_len,
+    const void *msg, uint16_t len
+) {
+    ring_share_lane_t *lane = &self->lanes[id];
+
+    mutex_lock(&lane->lock);
+    lane->buffer[0] = component;
+    if (header_len > 0)
+        memcpy(lane->buffer + 1, header, header_len);
+    memcpy(lane->buffer + 1 + header_len, msg, len);
+    return lane;
+}
+
+static void lane_end(ring_share_lane_t *lane) {
+    mutex_unlock(&lane->lock);
+}
+
+typedef struct rs_waiter {
+    event_t done;
+    bool delivered;
+} rs_waiter_t;
+
+static void wake_waiter(void *context, bool delivered) {
+    rs_waiter_t *waiter = context;
+
+    waiter->delivered = delivered;
+    event_signal(&waiter->done);
+}
+
 bool rs_init(ring_share_t *self, siblings_t *sb) {
     memset(self, 0, sizeof(ring_share_t));
 
-    if (!mutex_create(&self->broadcast_lock)) {
-        os_panic("Could not create mutex");
-        return false;
+    for (int i = 0; i < RS_LANES; i++) {
+        if (!mutex_create(&self->lanes[i].lock)) {
+            os_panic("Could not create mutex");
+            return false;
+        }
     }
 
     self->siblings = sb;
@@ -44,23 +95,71 @@ void rs_register_component(ring_share_t *self, component_id_t component, ring_ca
 }
 
 bool rs_broadcast(ring_share_t *self, component_id_t component, const void *msg, uint16_t len) {
+    return rs_broadcast_with_header(self, component, NULL, 0, msg, len);
+}
+
+bool rs_broadcast_with_header(ring_share_t *self, component_id_t component, const void *header, uint16_t header_len,
+                              const void *msg, uint16_t len) {
+    if (header_len + len > RS_MAX_BROADCAST_LEN) {
+        os_panic("rs_broadcast message too long (%u)", header_len + len);
+        return false;
+    }
+
+    rs_waiter_t waiter = {.delivered = false};
+    if (!event_create(&waiter.done)) {
+        log_error(TAG, "[rs_broadcast] Could not create event -- dropping message");
+        return false;
+    }
+
+    // The ring layer copies the message, so the lane is released before
+    // waiting for the outcome, which may take several retries
+    rs_lane_t id = lane_of(component);
+    ring_share_lane_t *lane = lane_begin(self, id, component, header, header_len, msg, len);
+    bool queued = sb_broadcast_to_siblings_async(self->siblings, lane->buffer, header_len + len + 1, (sb_lane_t)id,
+                                                 component, wake_waiter, &waiter);
+    lane_end(lane);
+
+    if (queued)
+        event_wait(&waiter.done);
+    event_destroy(&waiter.done);
+
+    return queued && waiter.delivered;
+}
+
+bool rs_broadcast_async(ring_share_t *self, component_id_t component, const void *msg, uint16_t len,
+                        ring_share_done_fn_t done, void *ctx) {
     if (len > RS_MAX_BROADCAST_LEN) {
-        os_panic("rs_broadcast message too long (%u)", len);
+        os_panic("rs_broadcast_async message too long (%u)", len);
         return false;
     }
 
-    bool ret = false;
+    // The ring layer copies the message, the lane is only held to build it
+    rs_lane_t id = lane_of(component);
+    ring_share_lane_t *lane = lane_begin(self, id, component, NULL, 0, msg, len);
+    bool ret = sb_broadcast_to_siblings_async(self->siblings, lane->buffer, len + 1, (sb_lane_t)id, component, done, ctx);
+    lane_end(lane);
 
-    WITH_LOCK(&self->broadcast_lock, {
-        self->buffer[0] = component;
-        memcpy(self->buffer + 1, msg, len);
-        ret = sb_broadcast_to_siblings(self->siblings, self->buffer, len + 1);
-    });
+    return ret;
+}
+
+bool rs_send_to(ring_share_t *self, orientation_t dst, component_id_t component, const void *msg, uint16_t len,
+                ring_share_done_fn_t done, void *ctx) {
+    if (len > RS_MAX_BROADCAST_LEN) {
+        os_panic("rs_send_to message too long (%u)", len);
+        return false;
+    }
+
+    rs_lane_t id = lane_of(component);
+    ring_share_lane_t *lane = lane_begin(self, id, component, NULL, 0, msg, len);
+    bool ret = sb_send_to_sibling(self->siblings, dst, lane->buffer, len + 1, (sb_lane_t)id, component, done, ctx);
+    lane_end(lane);
 
     return ret;
 }
 
 void rs_shutdown(ring_share_t *self) {
-    mutex_destroy(&self->broadcast_lock);
+    for (int i = 0; i < RS_LANES; i++) {
+        mutex_destroy(&self->lanes[i].lock);
+    }
     memset(self, 0, sizeof(ring_share_t));
 }
\ No newline at end of file
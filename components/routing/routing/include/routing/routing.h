@@ -118,6 +118,15 @@ void rt_on_tick(routing_t *self, uint32_t dt_ms);
  */
 rt_routing_result_t rt_do_route(routing_t *self, uint32_t src_ip, uint32_t dst_ip);
 
+/**
+ * Raw routing table lookup.
+ *
+ * Returns the orientation of the sibling whose wireless link leads to dst_ip
+ * (the current device's own orientation means ROUTE_WIFI). Useful to address
+ * packets sent through SPI to the sibling that will actually route them.
+ */
+orientation_t rt_route_output(routing_t *self, uint32_t dst_ip);
+
 /**
  * Free up resources used by routing module.
  */
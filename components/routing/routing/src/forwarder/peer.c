@@ -52,7 +52,7 @@ static void on_handshake(routing_t *self, const rt_peer_handshake_t *event) {
             },
         };
 
-        rs_broadcast(self->deps.rs, RS_ROUTING, &provision, sizeof(provision));
+        rs_broadcast_async(self->deps.rs, RS_ROUTING, &provision, sizeof(provision), NULL, NULL);
     } else {
         // We already have a network, add a redundant route to the table
         add_global_route(self, &event->external_network, self->orientation);
@@ -80,7 +80,7 @@ static void on_update_dtr(routing_t *self, const rt_peer_update_dtr_t *event) {
             .event_id = SIBL_UPDATE_DTR,
             .payload.update_dtr.dtr = peer_dtr + 1,
         };
-        rs_broadcast(self->deps.rs, RS_ROUTING, &event, sizeof(event));
+        rs_broadcast_async(self->deps.rs, RS_ROUTING, &event, sizeof(event), NULL, NULL);
     }
 }
 
@@ -106,7 +106,7 @@ static void on_new_gateway_request(routing_t *self, const rt_peer_new_gateway_re
 
     if (state->dtr == 1) {
         // I am root
-        rs_broadcast(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event));
+        rs_broadcast_async(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event), NULL, NULL);
         return;
     }
 
@@ -115,7 +115,7 @@ static void on_new_gateway_request(routing_t *self, const rt_peer_new_gateway_re
 
     state->global_state = GLOBAL_STATE_ON_GW_REQUEST;
     state->dtr = 0;
-    rs_broadcast(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event));
+    rs_broadcast_async(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event), NULL, NULL);
 }
 
 static void on_new_gateway_response(routing_t *self, const rt_peer_new_gateway_response_t *event) {
@@ -138,7 +138,7 @@ static void on_new_gateway_response(routing_t *self, const rt_peer_new_gateway_r
         .payload.new_gateway_winner.dtr = state->dtr,
         .payload.new_gateway_winner.network = event->external_network,
     };
-    rs_broadcast(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event));
+    rs_broadcast_async(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event), NULL, NULL);
 }
 
 static void on_peer_lost(routing_t *self, const network_t *connection) {
@@ -157,7 +157,7 @@ static void on_peer_lost(routing_t *self, const network_t *connection) {
         rt_sibl_event_t sibl_event = {
             .event_id = SIBL_SEND_NEW_GATEWAY_REQUEST,
         };
-        rs_broadcast(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event));
+        rs_broadcast_async(self->deps.rs, RS_ROUTING, &sibl_event, sizeof(sibl_event), NULL, NULL);
     }
 }
 
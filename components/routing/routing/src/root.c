@@ -61,7 +61,7 @@ static void on_tick(routing_t *self, uint32_t dt_ms) {
                 .dtr = 1,
             },
         };
-        rs_broadcast(self->deps.rs, RS_ROUTING, &event, sizeof(event));
+        rs_broadcast_async(self->deps.rs, RS_ROUTING, &event, sizeof(event), NULL, NULL);
     } else {
         // Continue waiting
         state->gateway_requested_timeout -= dt_ms;
@@ -228,11 +228,16 @@ void rt_on_start(routing_t *self) {
     sync_request_critical_section(self->deps.sync, RS_ROUTING);
 }
 
+orientation_t rt_route_output(routing_t *self, uint32_t dst_ip) {
+    orientation_t output;
+    WITH_LOCK(self->node_state.m_lock, { output = routing_table_route(&self->node_state.routing_table, dst_ip); });
+    return output;
+}
+
 rt_routing_result_t rt_do_route(routing_t *self, uint32_t src_ip, uint32_t dst_ip) {
     (void)src_ip;
 
-    orientation_t output;
-    WITH_LOCK(self->node_state.m_lock, { output = routing_table_route(&self->node_state.routing_table, dst_ip); });
+    orientation_t output = rt_route_output(self, dst_ip);
 
     if (output == self->orientation)
         return ROUTE_WIFI;
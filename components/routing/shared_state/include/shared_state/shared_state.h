@@ -21,7 +21,6 @@ typedef struct shared_data {
 typedef struct shared_state {
     sync_t *sync;
     ring_share_t *rs;
-    mutex_t broadcast_lock;
     uint8_t orientation;
     shared_data_t data[RS_LAST_COMPONENT_ID];
 } shared_state_t;
@@ -34,9 +34,6 @@ bool ss_init(shared_state_t *self, sync_t *sync, ring_share_t *rs, orientation_t
     self->rs = rs;
     self->orientation = orientation;
 
-    if (!mutex_create(&self->broadcast_lock))
-        return false;
-
     rs_register_component(
         self->rs, RS_SHARED_STATE,
         (ring_callback_t){
@@ -51,15 +48,10 @@ bool ss_init(shared_state_t *self, sync_t *sync, ring_share_t *rs, orientation_t
 static void broadcast_data(shared_state_t *self, component_id_t component) {
     shared_data_t *data = &self->data[component];
 
-    WITH_LOCK(data->lock, {
-        WITH_LOCK(self->broadcast_lock, {
-            uint8_t buffer[1 + data->length];
-            buffer[0] = component;
-            memcpy(buffer + 1, data->ptr, data->length);
+    uint8_t header = component;
 
-            rs_broadcast(self->rs, RS_SHARED_STATE, buffer, 1 + data->length);
-        });
-    });
+    // The data goes straight into the ring_share lane, whose lock orders the refreshes
+    WITH_LOCK(data->lock, { rs_broadcast_with_header(self->rs, RS_SHARED_STATE, &header, 1, data->ptr, data->length); });
 }
 
 void ss_watch(shared_state_t *self, component_id_t component, shared_data_t data) {
@@ -83,5 +75,4 @@ void ss_destroy(shared_state_t *self) {
             .context = NULL,
         }
     );
-    mutex_destroy(&self->broadcast_lock);
 }
\ No newline at end of file
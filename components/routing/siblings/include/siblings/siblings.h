@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "routing_config/routing_config.h"
+
 typedef void (*siblings_callback_t)(void *context, const uint8_t *msg, uint16_t len);
 
 typedef struct siblings {
@@ -11,6 +13,22 @@ typedef struct siblings {
     void *context;
 } siblings_t;
 
+/**
+ * Queue a message waits in before the ring layer sends it. Control
+ * messages go first and bulk ones never fill every broadcast slot.
+ */
+typedef enum sb_lane {
+    SB_LANE_CONTROL = 0,
+    SB_LANE_BULK = 1,
+} sb_lane_t;
+
+/**
+ * Messages passed with the same stream are delivered in the order they were
+ * queued: the ring layer holds each one back until the previous one of its
+ * stream is delivered or given up. Streams go from 0 to SB_MAX_STREAMS - 1.
+ */
+#define SB_MAX_STREAMS 16
+
 /**
  * Registers a function to be called whenever a broadcast sibling message is received
  */
@@ -21,6 +39,29 @@ void sb_register_callback(siblings_t *sb, siblings_callback_t callback, void *co
  *
  * Returns true if the broadcast was successful, false otherwise.
  */
-bool sb_broadcast_to_siblings(siblings_t *sb, const uint8_t *msg, uint16_t len);
+bool sb_broadcast_to_siblings(siblings_t *sb, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream);
+
+typedef void (*siblings_done_t)(void *context, bool delivered);
+
+/**
+ * Queues a broadcast to all sibling devices and returns without waiting.
+ *
+ * The message is copied and retried by the ring layer. If given, done is
+ * called with the outcome; it must not block.
+ *
+ * Returns false if the message could not be queued.
+ */
+bool sb_broadcast_to_siblings_async(siblings_t *sb, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream, siblings_done_t done, void *context);
+
+/**
+ * Queues a message for a single sibling device and returns without waiting.
+ *
+ * Only the destination receives it. If done is given, the destination
+ * acknowledges the message, the ring layer retries until it does, and done
+ * gets the outcome; it must not block.
+ *
+ * Returns false if the message could not be queued, or dst is this device.
+ */
+bool sb_send_to_sibling(siblings_t *sb, orientation_t dst, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream, siblings_done_t done, void *context);
 
 #endif  // _SIBLINGS_H_
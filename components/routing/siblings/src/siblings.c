@@ -6,6 +6,14 @@ void sb_register_callback(siblings_t *sb, siblings_callback_t callback, void *co
     sb->context = context;
 }
 
-bool sb_broadcast_to_siblings(siblings_t *sb, const uint8_t *msg, uint16_t len){
-    return node_broadcast_to_siblings(msg, len);
+bool sb_broadcast_to_siblings(siblings_t *sb, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream){
+    return node_broadcast_to_siblings(msg, len, (node_lane_t)lane, stream);
+}
+
+bool sb_broadcast_to_siblings_async(siblings_t *sb, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream, siblings_done_t done, void *context){
+    return node_broadcast_to_siblings_async(msg, len, (node_lane_t)lane, stream, done, context);
+}
+
+bool sb_send_to_sibling(siblings_t *sb, orientation_t dst, const uint8_t *msg, uint16_t len, sb_lane_t lane, uint8_t stream, siblings_done_t done, void *context){
+    return node_send_to_sibling_async((node_device_orientation_t)(dst - ORIENTATION_NORTH), msg, len, (node_lane_t)lane, stream, done, context);
 }
@@ -17,6 +17,7 @@ typedef enum {
 typedef struct {
     uint8_t destination;
     uint8_t cs_id;
+    uint8_t seq;  // bumped on every hand-off of the token, kept when a grant is sent again
 } sync_token_grant_t;
 
 typedef struct {
@@ -31,6 +32,13 @@ typedef struct {
     };
 } sync_msg_t;
 
+// Token grant in flight, sent again until its destination acknowledges it
+typedef struct sync_grant {
+    struct sync *sync;
+    sync_token_grant_t grant;
+    volatile bool retry;  // the last send failed, sync_on_tick sends it again
+} sync_grant_t;
+
 typedef struct sync_impl {
     void (*on_token_grant)(struct sync *self, const sync_token_grant_t *grant);
     void (*on_token_request)(struct sync *self, const sync_token_request_t *request);
@@ -7,6 +7,7 @@ extern "C" {
 
 #include <stdbool.h>
 
+#include "os/os.h"
 #include "routing_config/routing_config.h"
 #include "ring_share/ring_share.h"
 #include "sync/impl.h"
@@ -45,6 +46,10 @@ typedef struct sync {
     uint8_t orientation;
     bool is_leader;
     sync_cs_callback_t critical_sections[RS_LAST_COMPONENT_ID];
+    sync_grant_t grants[RS_LAST_COMPONENT_ID];  // one token per component, so one grant
+    mutex_t grants_lock;
+    uint8_t grant_seq[RS_LAST_COMPONENT_ID];    // seq of the last grant received, per token
+    bool grant_seen[RS_LAST_COMPONENT_ID];
     sync_impl_t *impl;
     union {
         sync_leader_t leader;
@@ -83,6 +88,25 @@ void sync_request_critical_section(sync_t *self, component_id_t cs_id);
  */
 bool sync_is_inside_critical_section(sync_t *sync, component_id_t cs_id);
 
+/**
+ * Hand the token of a critical section to another device.
+ *
+ * The grant asks its destination for an acknowledgement. Whenever it
+ * cannot be queued or the ring layer gives up on it, it is sent again from
+ * sync_on_tick, so a lost grant never loses the token. Each grant carries
+ * the hand-off sequence of the token, so a grant that arrived but whose
+ * acknowledgements were lost is ignored the second time.
+ */
+void sync_send_token_grant(sync_t *self, component_id_t cs_id, uint8_t destination);
+
+/**
+ * Timer update callback.
+ *
+ * Should be called periodically, like rt_on_tick. Sends again the token
+ * grants that could not be delivered.
+ */
+void sync_on_tick(sync_t *self, uint32_t dt_ms);
+
 /**
  * Free resources associated with this component.
  */
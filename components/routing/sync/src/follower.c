@@ -1,5 +1,6 @@
 #include "follower.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "routing_config/routing_config.h"
@@ -18,14 +19,12 @@ static void on_token_grant(sync_t *sync, const sync_token_grant_t *grant) {
         callback->is_inside = false;
     }
 
-    sync_msg_t msg = { .kind = SYNC_MSG_TOKEN_GRANT,
-                       .token_grant = { .cs_id = grant->cs_id, .destination = (sync->orientation % N_DEVICES) + 1 } };
-    rs_broadcast(sync->rs, RS_SYNC, (const uint8_t *)&msg, sizeof(msg));
+    sync_send_token_grant(sync, grant->cs_id, (sync->orientation % N_DEVICES) + 1);
 }
 
 static void request_critical_section(sync_t *sync, component_id_t cs_id) {
     sync_msg_t msg = { .kind = SYNC_MSG_TOKEN_REQUEST, .token_request = { .cs_id = cs_id } };
-    rs_broadcast(sync->rs, RS_SYNC, (const uint8_t *)&msg, sizeof(msg));
+    rs_broadcast_async(sync->rs, RS_SYNC, (const uint8_t *)&msg, sizeof(msg), NULL, NULL);
 }
 
 static sync_impl_t FOLLOWER_IMPL = {
@@ -15,13 +15,7 @@ static void issue_new_token(sync_t *sync, component_id_t cs_id) {
     sync_leader_t *self = GET_CTX(sync);
     self->is_token_out[cs_id] = true;
 
-    sync_msg_t msg = { .kind = SYNC_MSG_TOKEN_GRANT,
-                       .token_grant = {
-                           .cs_id = cs_id,
-                           .destination = self->first_device_to_get_token,
-                       } };
-
-    rs_broadcast(sync->rs, RS_SYNC, (const uint8_t *)&msg, sizeof(msg));
+    sync_send_token_grant(sync, cs_id, self->first_device_to_get_token);
 }
 
 static void request_critical_section(sync_t *sync, component_id_t cs_id) {
@@ -9,6 +9,20 @@
 
 #define TAG "sync"
 
+// A grant sent again after all its acknowledgements were lost carries the
+// same seq as the one already received
+static bool is_repeated_grant(sync_t *self, const sync_token_grant_t *grant) {
+    if (grant->destination != self->orientation || grant->cs_id >= RS_LAST_COMPONENT_ID)
+        return false;
+
+    if (self->grant_seen[grant->cs_id] && self->grant_seq[grant->cs_id] == grant->seq)
+        return true;
+
+    self->grant_seen[grant->cs_id] = true;
+    self->grant_seq[grant->cs_id] = grant->seq;
+    return false;
+}
+
 static void on_sibling_message(void *ctx, const uint8_t *raw_msg, uint16_t len) {
     if (len != sizeof(sync_msg_t)) {
         os_panic("Invalid sibling message received: len = %u\n", len);
@@ -20,6 +34,11 @@ static void on_sibling_message(void *ctx, const uint8_t *raw_msg, uint16_t len)
 
     switch (msg->kind) {
         case SYNC_MSG_TOKEN_GRANT:
+            if (is_repeated_grant(self, &msg->token_grant)) {
+                log_info(TAG, "Repeated token grant for cs_id=%u (seq=%u), ignoring", msg->token_grant.cs_id,
+                         msg->token_grant.seq);
+                break;
+            }
             self->impl->on_token_grant(self, &msg->token_grant);
             break;
         case SYNC_MSG_TOKEN_REQUEST:
@@ -32,12 +51,40 @@ static void on_sibling_message(void *ctx, const uint8_t *raw_msg, uint16_t len)
     }
 }
 
+// Runs in the ring layer and must not block: the grant is sent again from sync_on_tick
+static void on_grant_done(void *ctx, bool delivered) {
+    sync_grant_t *pending = ctx;
+
+    if (!delivered) {
+        log_warn(TAG, "Token grant for cs_id=%u to %u not acknowledged, retrying", pending->grant.cs_id,
+                 pending->grant.destination);
+        pending->retry = true;
+    }
+}
+
+// Called with grants_lock held
+static void send_grant(sync_grant_t *pending) {
+    sync_msg_t msg = { .kind = SYNC_MSG_TOKEN_GRANT, .token_grant = pending->grant };
+
+    pending->retry = false;
+    if (!rs_send_to(pending->sync->rs, pending->grant.destination, RS_SYNC, (const uint8_t *)&msg, sizeof(msg),
+                    on_grant_done, pending)) {
+        log_warn(TAG, "Could not queue token grant for cs_id=%u, retrying", pending->grant.cs_id);
+        pending->retry = true;
+    }
+}
+
 bool sync_init(sync_t *self, ring_share_t *rs, orientation_t orientation) {
     memset(self, 0, sizeof(sync_t));
     self->rs = rs;
     self->orientation = orientation;
     self->is_leader = (orientation == ORIENTATION_CENTER);
 
+    if (!mutex_create(&self->grants_lock)) {
+        os_panic("Could not create mutex");
+        return false;
+    }
+
     rs_register_component(self->rs, RS_SYNC, (ring_callback_t){ .callback = on_sibling_message, .context = self });
 
     if (self->is_leader) {
@@ -60,6 +107,31 @@ void sync_request_critical_section(sync_t *self, component_id_t cs_id) {
     self->impl->request_critical_section(self, cs_id);
 }
 
+void sync_send_token_grant(sync_t *self, component_id_t cs_id, uint8_t destination) {
+    sync_grant_t *pending = &self->grants[cs_id];
+
+    mutex_lock(&self->grants_lock);
+    pending->sync = self;
+    pending->grant = (sync_token_grant_t){
+        .destination = destination,
+        .cs_id = cs_id,
+        .seq = (uint8_t)(self->grant_seq[cs_id] + 1),
+    };
+    send_grant(pending);
+    mutex_unlock(&self->grants_lock);
+}
+
+void sync_on_tick(sync_t *self, uint32_t dt_ms) {
+    (void)dt_ms;
+
+    mutex_lock(&self->grants_lock);
+    for (int i = 0; i < RS_LAST_COMPONENT_ID; i++) {
+        if (self->grants[i].retry)
+            send_grant(&self->grants[i]);
+    }
+    mutex_unlock(&self->grants_lock);
+}
+
 bool sync_is_inside_critical_section(sync_t *sync, component_id_t cs_id) {
     return sync->critical_sections[cs_id].is_inside;
 }
@@ -67,4 +139,5 @@ bool sync_is_inside_critical_section(sync_t *sync, component_id_t cs_id) {
 void sync_destroy(sync_t *self) {
     // Un-register sibling messages
     rs_register_component(self->rs, RS_SYNC, (ring_callback_t){ .callback = NULL, .context = NULL });
+    mutex_destroy(&self->grants_lock);
 }
\ No newline at end of file
@@ -8,7 +8,6 @@
 #include "client.h"
 
 #define SERVER_PORT 3999
-#define BUFFER_SIZE 512
 #define RETRY_DELAY_MS 5000
 
 static const char *LOGGING_TAG = "tcp_client";
@@ -48,10 +47,14 @@ static bool get_network_address_and_mask(void) {
 }
 
 static void socket_read_loop(const int sock, const char *server_ip) {
-    uint8_t rx_buffer[BUFFER_SIZE];
+    node_message_t *m = NULL;
 
     while (1) {
-        int len = recv(sock, rx_buffer, sizeof(rx_buffer), 0);
+        // Received straight into a pool buffer, which goes up to the callback as is
+        if (m == NULL) {
+            m = node_message_alloc(NODE_MESSAGE_POOL_PEER, portMAX_DELAY);
+        }
+        int len = recv(sock, m->data, sizeof(m->data), 0);
         if (len < 0) {
             ESP_LOGE(LOGGING_TAG, "Receive error from %s: errno %d", server_ip, errno);
             break;
@@ -59,14 +62,19 @@ static void socket_read_loop(const int sock, const char *server_ip) {
             ESP_LOGW(LOGGING_TAG, "Server %s closed the connection", server_ip);
             break;
         } else {
-            node_on_peer_message(rx_buffer, len);
+            m->length = len;
+            node_on_peer_message(m);
+            m = NULL;
             if(!peer_connected) {
                 node_on_peer_connected(peer_net, peer_mask, PEER_CLIENT);
                 peer_connected = true;
             }
         }
     }
-    
+
+    if (m != NULL) {
+        node_message_unref(m);
+    }
     if(peer_connected) {
         node_on_peer_lost(peer_net, peer_mask, PEER_CLIENT);
         peer_connected = false;
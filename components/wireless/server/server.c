@@ -11,7 +11,6 @@
 #define KEEPALIVE_IDLE 5     // start probing after 5s idle
 #define KEEPALIVE_INTERVAL 5  // probe every 5s
 #define KEEPALIVE_COUNT 3      // drop after 3 failed probes
-#define BUFFER_SIZE 512
 
 static const char *LOGGING_TAG = "tcp_server";
 
@@ -40,12 +39,16 @@ static bool get_network_address_and_mask(void) {
 // Function to read data from the client socket
 static void socket_read_loop(const int sock, const char *client_ip) {
 
-  uint8_t rx_buffer[BUFFER_SIZE];
+  node_message_t *m = NULL;
   client_sock = sock;
   node_on_peer_connected(peer_net, peer_mask, PEER_SERVER);
   
   while (1) {
-    int len = recv(sock, rx_buffer, sizeof(rx_buffer), 0);
+    // Received straight into a pool buffer, which goes up to the callback as is
+    if (m == NULL) {
+      m = node_message_alloc(NODE_MESSAGE_POOL_PEER, portMAX_DELAY);
+    }
+    int len = recv(sock, m->data, sizeof(m->data), 0);
     
     if (len < 0) {
       ESP_LOGE(LOGGING_TAG, "Receive error from %s: errno %d", client_ip, errno);
@@ -54,10 +57,15 @@ static void socket_read_loop(const int sock, const char *client_ip) {
       ESP_LOGW(LOGGING_TAG, "Client %s disconnected gracefully", client_ip);
       break;
     } else {
-      node_on_peer_message(rx_buffer, len);
+      m->length = len;
+      node_on_peer_message(m);
+      m = NULL;
     }
   }
 
+  if (m != NULL) {
+    node_message_unref(m);
+  }
   node_on_peer_lost(peer_net, peer_mask, PEER_SERVER);
   client_sock = -1;
 }